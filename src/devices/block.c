@@ -3,7 +3,160 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Block request queues.
+
+   Each block device has a queue of pending requests and, once
+   the first request arrives, a dispatcher thread that feeds them
+   to the driver in batches and then calls each request's
+   completion function.  block_submit() returns immediately;
+   block_read() and the other synchronous functions submit a
+   request and wait for it to complete.
+
+   Most drivers transfer synchronously, so the dispatcher gives
+   them one batch at a time.  A driver that provides the START
+   operation instead begins a transfer and reports its completion
+   later, usually from an interrupt handler, through
+   block_transfer_done().  The dispatcher keeps up to BATCH_MAX
+   batches in flight on such a device.
+
+   The dispatcher is an elevator with deadlines.  Normally it
+   sweeps upward through the disk, taking the pending request
+   with the lowest sector at or after the end of the previous
+   batch, and wrapping around to the lowest pending sector at the
+   top.  But if the oldest pending request has waited past its
+   deadline, it goes next, so that a stream of requests near the
+   head cannot starve one far away.  Reads get a shorter deadline
+   than writes, because a thread is usually waiting on a read,
+   whereas writes are usually write-behind.
+
+   Requests are also divided into I/O classes (see block.h), each
+   with its own elevator.  The dispatcher takes its next batch
+   from the highest class with pending requests, unless the oldest
+   request in a lower class has waited longer than that class's
+   starvation limit, in which case that class goes next.  By
+   default a request takes the class set for its thread with
+   block_set_io_class(), or if none is set, realtime for threads
+   whose priority is above PRI_DEFAULT and best effort for the
+   rest.
+
+   When a request is chosen, following requests of the same kind
+   for the sectors immediately after it are merged into the same
+   batch and given to the driver as a single transfer, through a
+   bounce buffer if their buffers are not already adjacent in
+   memory.  Each device has one bounce buffer, so only one batch
+   in flight can use it. */
+
+/* Deadlines for reads and writes, in timer ticks. */
+#define READ_EXPIRE (TIMER_FREQ / 2)
+#define WRITE_EXPIRE (TIMER_FREQ * 5)
+
+/* Longest time, in timer ticks, that a request in each I/O
+   class waits while higher classes are being served. */
+static const int64_t class_wait[BLOCK_IO_CLASS_CNT] =
+  {
+    [BLOCK_IO_BE] = TIMER_FREQ / 2,
+    [BLOCK_IO_IDLE] = TIMER_FREQ,
+  };
+
+/* Maximum number of sectors merged into one batch. */
+#define MERGE_MAX 64
+
+/* Maximum number of batches in flight on a device whose driver
+   provides the START operation. */
+#define BATCH_MAX 8
+
+/* A batch of requests merged into a single driver transfer. */
+struct block_batch
+  {
+    struct list_elem elem;              /* In queue's free or done list. */
+    struct block *block;                /* Device. */
+    struct list requests;               /* Requests, in sector order. */
+    bool write;                         /* True to write, false to read. */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    void *buffer;                       /* Buffer given to the driver. */
+  };
+
+/* A block device's request queue. */
+struct block_queue
+  {
+    struct lock lock;                   /* Protects the members below. */
+    struct list sorted[BLOCK_IO_CLASS_CNT]; /* Pending, by sector. */
+    struct list fifo[BLOCK_IO_CLASS_CNT];   /* Pending, by arrival. */
+    size_t pending_cnt;                 /* Number of pending requests. */
+    block_sector_t head;                /* Sector after last batch. */
+    bool started;                       /* Dispatcher thread started? */
+    struct list free_batches;           /* Batches not in flight. */
+    uint8_t *bounce;                    /* MERGE_MAX sectors, or null. */
+    bool bounce_busy;                   /* Bounce buffer in use? */
+
+    /* Up'd when a request is submitted or a transfer completes. */
+    struct semaphore wake;
+
+    /* Batches whose transfers have completed, not yet finished
+       by the dispatcher.  Protected by disabling interrupts,
+       because drivers add to it from interrupt handlers. */
+    struct list done;
+
+    struct block_batch batches[BATCH_MAX];
+  };
+
+/* Number of buckets in a latency histogram.  Bucket 0 counts
+   latencies under 2 us, bucket I counts latencies from 2**I up
+   to 2**(I + 1) us, and the last bucket counts everything
+   longer. */
+#define LATENCY_BUCKETS 24
+
+/* I/O metrics for a block device that does its own transfers,
+   that is, one whose requests are not remapped. */
+struct block_metrics
+  {
+    unsigned long long req_cnt;         /* Requests completed. */
+    unsigned long long submit_cnt;      /* Requests submitted. */
+    unsigned long long seq_cnt;         /* Requests submitted that started
+                                           where the previous one ended. */
+    unsigned long long bytes[2];        /* Bytes read [0], written [1]. */
+    unsigned long long latency[2][LATENCY_BUCKETS];
+                                        /* Submit-to-completion time
+                                           histograms for reads [0] and
+                                           writes [1]. */
+    block_sector_t next_sector;         /* Sector after previous request. */
+
+    size_t depth;                       /* Requests submitted, not done. */
+    size_t depth_max;                   /* Maximum value of DEPTH. */
+    int64_t depth_ns;                   /* When DEPTH last changed. */
+    int64_t depth_area;                 /* Integral of DEPTH over time,
+                                           in request-nanoseconds. */
+    int64_t first_ns;                   /* First request's submission. */
+  };
+
+/* One completed request in the trace buffer. */
+struct block_trace
+  {
+    const char *device;                 /* Device name. */
+    bool write;                         /* Write or read? */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    int64_t submit_ns;                  /* Times from timer_nsecs(). */
+    int64_t issue_ns;
+    int64_t complete_ns;
+  };
+
+/* Ring buffer of the most recently completed requests on all
+   devices, or null if tracing is disabled.  Protected by
+   disabling interrupts, since dispatchers for several devices
+   may record at once. */
+static struct block_trace *trace;
+static size_t trace_size;               /* Number of entries in TRACE. */
+static unsigned long long trace_cnt;    /* Number of requests recorded. */
 
 /* A block device. */
 struct block
@@ -19,6 +172,10 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+
+    struct block_queue queue;           /* Pending requests. */
+    unsigned long long batch_cnt;       /* Number of driver transfers. */
+    struct block_metrics metrics;       /* Protected by queue.lock. */
   };
 
 /* List of all block devices. */
@@ -28,6 +185,11 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void transfer_sync (struct block *, bool write, block_sector_t,
+                           size_t cnt, void *buffer);
+static void dispatcher (void *block_);
+static void metrics_submit (struct block_metrics *,
+                            const struct block_request *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -99,6 +261,22 @@ block_get_by_name (const char *name)
   return NULL;
 }
 
+/* Returns true if BLOCK is OUTER itself or a partition of OUTER,
+   so that writing to OUTER may overwrite BLOCK's data. */
+bool
+block_is_within (struct block *block, struct block *outer)
+{
+  while (block != outer)
+    {
+      block_sector_t sector = 0;
+
+      if (block->ops->remap == NULL)
+        return false;
+      block = block->ops->remap (block->aux, &sector);
+    }
+  return true;
+}
+
 /* Verifies that SECTOR is a valid offset within BLOCK.
    Panics if not. */
 static void
@@ -113,6 +291,17 @@ check_sector (struct block *block, block_sector_t sector)
     }
 }
 
+/* Verifies that the CNT sectors starting at SECTOR are all
+   within BLOCK.  Panics if not. */
+static void
+check_range (struct block *block, block_sector_t sector, size_t cnt)
+{
+  if (cnt > block->size || sector > block->size - cnt)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", count=%zu, "
+           "size=%"PRDSNu")\n", block_name (block), sector, cnt,
+           block->size);
+}
+
 /* Reads sector SECTOR from BLOCK into BUFFER, which must
    have room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to block devices, so external
@@ -121,8 +310,7 @@ void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  transfer_sync (block, false, sector, 1, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -134,9 +322,513 @@ void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
   check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  transfer_sync (block, true, sector, 1, (void *) buffer);
+}
+
+/* Reads the CNT sectors starting at SECTOR from BLOCK into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it move all the sectors with a
+   few large requests rather than one request per sector.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multi (struct block *block, block_sector_t sector, size_t cnt,
+                  void *buffer)
+{
+  transfer_sync (block, false, sector, cnt, buffer);
+}
+
+/* Writes the CNT sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving all
+   the data.  Drivers that support it move all the sectors with a
+   few large requests rather than one request per sector.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multi (struct block *block, block_sector_t sector, size_t cnt,
+                   const void *buffer)
+{
+  transfer_sync (block, true, sector, cnt, (void *) buffer);
+}
+
+/* Completion function for transfer_sync(). */
+static void
+sync_complete (struct block_request *r) 
+{
+  sema_up (r->aux);
+}
+
+/* Submits a request to transfer CNT sectors starting at SECTOR
+   between BLOCK and BUFFER, and waits for it to complete. */
+static void
+transfer_sync (struct block *block, bool write, block_sector_t sector,
+               size_t cnt, void *buffer) 
+{
+  struct block_request r;
+  struct semaphore done;
+
+  sema_init (&done, 0);
+  r.write = write;
+  r.io_class = BLOCK_IO_AUTO;
+  r.sector = sector;
+  r.cnt = cnt;
+  r.buffer = buffer;
+  r.complete = sync_complete;
+  r.aux = &done;
+  block_submit (block, &r);
+  sema_down (&done);
+}
+
+/* Returns true if request A's first sector precedes request
+   B's. */
+static bool
+sector_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct block_request *a
+    = list_entry (a_, struct block_request, sorted_elem);
+  const struct block_request *b
+    = list_entry (b_, struct block_request, sorted_elem);
+
+  return a->sector < b->sector;
+}
+
+/* Sets the I/O class of requests that the running thread
+   submits with class BLOCK_IO_AUTO, including all synchronous
+   reads and writes.  Passing BLOCK_IO_AUTO restores the default,
+   which follows the thread's priority. */
+void
+block_set_io_class (enum block_io_class io_class) 
+{
+  ASSERT (io_class < BLOCK_IO_CLASS_CNT);
+  thread_current ()->io_class = io_class;
+}
+
+/* Returns the I/O class for a request submitted by the running
+   thread with class IO_CLASS. */
+static enum block_io_class
+resolve_io_class (enum block_io_class io_class) 
+{
+  if (io_class == BLOCK_IO_AUTO)
+    io_class = thread_current ()->io_class;
+  if (io_class == BLOCK_IO_AUTO)
+    io_class = thread_get_priority () > PRI_DEFAULT ? BLOCK_IO_RT : BLOCK_IO_BE;
+  return io_class;
+}
+
+/* Queues request R to BLOCK and returns without waiting for it.
+   R->COMPLETE will be called, from BLOCK's dispatcher thread,
+   when the transfer is done.  Panics if R is out of range. */
+void
+block_submit (struct block *block, struct block_request *r) 
+{
+  struct block_queue *q;
+
+  ASSERT (r->cnt > 0);
+  ASSERT (r->complete != NULL);
+  ASSERT (r->io_class < BLOCK_IO_CLASS_CNT);
+  ASSERT (!intr_context ());
+
+  r->io_class = resolve_io_class (r->io_class);
+
+  /* Find the device that really does the work, counting the
+     transfer at each level. */
+  for (;;) 
+    {
+      check_range (block, r->sector, r->cnt);
+      if (r->write)
+        {
+          ASSERT (block->type != BLOCK_FOREIGN);
+          block->write_cnt += r->cnt;
+        }
+      else
+        block->read_cnt += r->cnt;
+
+      if (block->ops->remap == NULL)
+        break;
+      block = block->ops->remap (block->aux, &r->sector);
+    }
+
+  q = &block->queue;
+  lock_acquire (&q->lock);
+  if (!q->started) 
+    {
+      char name[sizeof block->name + 4];
+
+      snprintf (name, sizeof name, "blk_%s", block->name);
+      if (thread_create (name, PRI_MAX, dispatcher, block) == TID_ERROR)
+        PANIC ("%s: couldn't start dispatcher thread", block->name);
+      q->started = true;
+    }
+  r->submit_ns = timer_nsecs ();
+  metrics_submit (&block->metrics, r);
+  r->submitted = timer_ticks ();
+  r->deadline = r->submitted + (r->write ? WRITE_EXPIRE : READ_EXPIRE);
+  list_insert_ordered (&q->sorted[r->io_class], &r->sorted_elem,
+                       sector_less, NULL);
+  list_push_back (&q->fifo[r->io_class], &r->fifo_elem);
+  q->pending_cnt++;
+  lock_release (&q->lock);
+  sema_up (&q->wake);
+}
+
+/* Returns the I/O class from which Q's next batch should come.
+   Q must not be empty. */
+static enum block_io_class
+next_class (struct block_queue *q) 
+{
+  int64_t now = timer_ticks ();
+  int c;
+
+  /* Serve a starving lower class, lowest first. */
+  for (c = BLOCK_IO_CLASS_CNT - 1; c > BLOCK_IO_RT; c--)
+    if (!list_empty (&q->fifo[c])) 
+      {
+        struct block_request *oldest
+          = list_entry (list_front (&q->fifo[c]), struct block_request,
+                        fifo_elem);
+        if (now - oldest->submitted >= class_wait[c])
+          return c;
+      }
+
+  /* Otherwise serve the highest class with pending requests. */
+  for (c = BLOCK_IO_RT; c < BLOCK_IO_CLASS_CNT; c++)
+    if (!list_empty (&q->fifo[c]))
+      return c;
+  NOT_REACHED ();
+}
+
+/* Updates the queue depth in M to DEPTH, as of NOW. */
+static void
+metrics_set_depth (struct block_metrics *m, size_t depth, int64_t now) 
+{
+  m->depth_area += (int64_t) m->depth * (now - m->depth_ns);
+  m->depth_ns = now;
+  m->depth = depth;
+  if (depth > m->depth_max)
+    m->depth_max = depth;
+}
+
+/* Records the submission of request R in M. */
+static void
+metrics_submit (struct block_metrics *m, const struct block_request *r) 
+{
+  if (m->req_cnt == 0 && m->depth == 0)
+    m->first_ns = r->submit_ns;
+  m->submit_cnt++;
+  if (r->sector == m->next_sector)
+    m->seq_cnt++;
+  m->next_sector = r->sector + r->cnt;
+  metrics_set_depth (m, m->depth + 1, r->submit_ns);
+}
+
+/* Records the completion of request R on BLOCK at time NOW, in
+   BLOCK's metrics and in the trace buffer. */
+static void
+metrics_complete (struct block *block, const struct block_request *r,
+                  int64_t now) 
+{
+  struct block_metrics *m = &block->metrics;
+  int64_t us = (now - r->submit_ns) / 1000;
+  int bucket;
+
+  for (bucket = 0; bucket < LATENCY_BUCKETS - 1 && us >= 2; bucket++)
+    us /= 2;
+  m->latency[r->write][bucket]++;
+  m->bytes[r->write] += r->cnt * BLOCK_SECTOR_SIZE;
+  m->req_cnt++;
+  metrics_set_depth (m, m->depth - 1, now);
+
+  if (trace != NULL) 
+    {
+      enum intr_level old_level = intr_disable ();
+      struct block_trace *t = &trace[trace_cnt++ % trace_size];
+      t->device = block->name;
+      t->write = r->write;
+      t->sector = r->sector;
+      t->cnt = r->cnt;
+      t->submit_ns = r->submit_ns;
+      t->issue_ns = r->issue_ns;
+      t->complete_ns = now;
+      intr_set_level (old_level);
+    }
+}
+
+/* Removes the next batch of requests to dispatch from Q and
+   fills in B with them.  Q must not be empty. */
+static void
+next_batch (struct block_queue *q, struct block_batch *b) 
+{
+  enum block_io_class c;
+  struct list *sorted, *fifo;
+  struct block_request *first, *r;
+  struct list_elem *e;
+  bool adjacent;
+
+  ASSERT (lock_held_by_current_thread (&q->lock));
+  ASSERT (q->pending_cnt > 0);
+
+  c = next_class (q);
+  sorted = &q->sorted[c];
+  fifo = &q->fifo[c];
+
+  /* Choose the first request: the class's oldest one if it is
+     overdue, otherwise the next one up the elevator. */
+  first = list_entry (list_front (fifo), struct block_request, fifo_elem);
+  if (timer_ticks () < first->deadline) 
+    {
+      for (e = list_begin (sorted); e != list_end (sorted); e = list_next (e))
+        if (list_entry (e, struct block_request, sorted_elem)->sector
+            >= q->head)
+          break;
+      if (e == list_end (sorted))
+        e = list_begin (sorted);
+      first = list_entry (e, struct block_request, sorted_elem);
+    }
+
+  /* Take it, plus any requests that continue where it ends.
+     Requests whose buffers do not continue where the previous
+     one's ends can be merged only through the bounce buffer. */
+  list_init (&b->requests);
+  b->write = first->write;
+  b->sector = first->sector;
+  b->cnt = 0;
+  adjacent = true;
+  r = first;
+  for (;;) 
+    {
+      e = list_next (&r->sorted_elem);
+      list_remove (&r->sorted_elem);
+      list_remove (&r->fifo_elem);
+      list_push_back (&b->requests, &r->batch_elem);
+      q->pending_cnt--;
+      b->cnt += r->cnt;
+
+      if (e == list_end (sorted))
+        break;
+      r = list_entry (e, struct block_request, sorted_elem);
+      if (r->sector != b->sector + b->cnt || r->write != b->write
+          || b->cnt + r->cnt > MERGE_MAX)
+        break;
+      if ((uint8_t *) r->buffer
+          != (uint8_t *) first->buffer + b->cnt * BLOCK_SECTOR_SIZE) 
+        {
+          if (q->bounce == NULL || q->bounce_busy)
+            break;
+          adjacent = false;
+        }
+    }
+  q->head = b->sector + b->cnt;
+
+  if (adjacent)
+    b->buffer = first->buffer;
+  else 
+    {
+      b->buffer = q->bounce;
+      q->bounce_busy = true;
+    }
+}
+
+/* Has BLOCK's driver synchronously transfer CNT sectors starting
+   at SECTOR between the device and BUFFER. */
+static void
+driver_transfer (struct block *block, bool write, block_sector_t sector,
+                 size_t cnt, void *buffer) 
+{
+  const struct block_operations *ops = block->ops;
+  uint8_t *p = buffer;
+  size_t i;
+
+  if (write && ops->write_multi != NULL)
+    ops->write_multi (block->aux, sector, cnt, buffer);
+  else if (!write && ops->read_multi != NULL)
+    ops->read_multi (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++, p += BLOCK_SECTOR_SIZE)
+      if (write)
+        ops->write (block->aux, sector + i, p);
+      else
+        ops->read (block->aux, sector + i, p);
+}
+
+/* Copies data between the bounce buffer used by batch B and the
+   buffers of B's requests: into the bounce buffer if TO_BOUNCE
+   is true, otherwise out of it. */
+static void
+copy_bounce (struct block_batch *b, bool to_bounce) 
+{
+  uint8_t *p = b->buffer;
+  struct list_elem *e;
+
+  for (e = list_begin (&b->requests); e != list_end (&b->requests);
+       e = list_next (e)) 
+    {
+      struct block_request *r = list_entry (e, struct block_request,
+                                            batch_elem);
+      size_t size = r->cnt * BLOCK_SECTOR_SIZE;
+
+      if (to_bounce)
+        memcpy (p, r->buffer, size);
+      else
+        memcpy (r->buffer, p, size);
+      p += size;
+    }
+}
+
+/* Finishes batch B, whose transfer is complete: records metrics,
+   makes B available for reuse, and completes its requests. */
+static void
+finish_batch (struct block_batch *b) 
+{
+  struct block *block = b->block;
+  struct block_queue *q = &block->queue;
+  bool bounced = b->buffer == q->bounce;
+  struct list requests;
+  struct list_elem *e;
+  int64_t now;
+
+  if (bounced && !b->write)
+    copy_bounce (b, false);
+
+  /* Record metrics first, because a request may be freed as soon
+     as its completion function is called. */
+  list_init (&requests);
+  lock_acquire (&q->lock);
+  now = timer_nsecs ();
+  while (!list_empty (&b->requests)) 
+    {
+      e = list_pop_front (&b->requests);
+      metrics_complete (block, list_entry (e, struct block_request,
+                                           batch_elem), now);
+      list_push_back (&requests, e);
+    }
+  if (bounced)
+    q->bounce_busy = false;
+  list_push_back (&q->free_batches, &b->elem);
+  lock_release (&q->lock);
+
+  while (!list_empty (&requests)) 
+    {
+      struct block_request *r
+        = list_entry (list_pop_front (&requests), struct block_request,
+                      batch_elem);
+      r->complete (r);
+    }
+}
+
+/* Starts the transfer for batch B.  For a synchronous driver,
+   the transfer is complete and B finished when this returns. */
+static void
+start_batch (struct block_batch *b) 
+{
+  struct block *block = b->block;
+  int64_t now = timer_nsecs ();
+  struct list_elem *e;
+
+  for (e = list_begin (&b->requests); e != list_end (&b->requests);
+       e = list_next (e))
+    list_entry (e, struct block_request, batch_elem)->issue_ns = now;
+  if (b->buffer == block->queue.bounce && b->write)
+    copy_bounce (b, true);
+
+  block->batch_cnt++;
+  if (block->ops->start != NULL)
+    block->ops->start (block->aux, b->write, b->sector, b->cnt, b->buffer,
+                       b);
+  else 
+    {
+      driver_transfer (block, b->write, b->sector, b->cnt, b->buffer);
+      finish_batch (b);
+    }
+}
+
+/* Called by a driver with a START operation when the transfer
+   that START was asked to begin with the given TAG has
+   completed.  May be called from an interrupt handler. */
+void
+block_transfer_done (void *tag) 
+{
+  struct block_batch *b = tag;
+  struct block_queue *q = &b->block->queue;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  list_push_back (&q->done, &b->elem);
+  intr_set_level (old_level);
+  sema_up (&q->wake);
+}
+
+/* Returns the I/O class of the requests in the transfer that
+   START was asked to begin with the given TAG, for drivers that
+   pass the transfer on to other block devices. */
+enum block_io_class
+block_transfer_io_class (void *tag) 
+{
+  struct block_batch *b = tag;
+
+  return list_entry (list_front (&b->requests), struct block_request,
+                     batch_elem)->io_class;
+}
+
+/* Removes and returns a batch from Q's done list, or returns a
+   null pointer if the list is empty. */
+static struct block_batch *
+pop_done (struct block_queue *q) 
+{
+  struct block_batch *b = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&q->done))
+    b = list_entry (list_pop_front (&q->done), struct block_batch, elem);
+  intr_set_level (old_level);
+  return b;
+}
+
+/* Dispatcher thread for the block device passed as BLOCK_.
+   Repeatedly finishes completed transfers and starts new ones
+   from the device's queue. */
+static void
+dispatcher (void *block_) 
+{
+  struct block *block = block_;
+  struct block_queue *q = &block->queue;
+  size_t batch_cnt = block->ops->start != NULL ? BATCH_MAX : 1;
+  size_t i;
+
+  /* Without a bounce buffer, requests are still sorted, but
+     merged only if their buffers are adjacent. */
+  lock_acquire (&q->lock);
+  q->bounce = palloc_get_multiple (0, MERGE_MAX * BLOCK_SECTOR_SIZE / PGSIZE);
+  for (i = 0; i < batch_cnt; i++) 
+    {
+      q->batches[i].block = block;
+      list_push_back (&q->free_batches, &q->batches[i].elem);
+    }
+  lock_release (&q->lock);
+
+  for (;;) 
+    {
+      struct block_batch *b;
+
+      while ((b = pop_done (q)) != NULL)
+        finish_batch (b);
+
+      lock_acquire (&q->lock);
+      while (q->pending_cnt > 0 && !list_empty (&q->free_batches)) 
+        {
+          b = list_entry (list_pop_front (&q->free_batches),
+                          struct block_batch, elem);
+          next_batch (q, b);
+          lock_release (&q->lock);
+          start_batch (b);
+          lock_acquire (&q->lock);
+        }
+      lock_release (&q->lock);
+
+      sema_down (&q->wake);
+    }
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,10 +852,84 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Prints BLOCK's latency histogram for writes if WRITE is true,
+   otherwise for reads.  Only nonempty buckets are printed, each
+   labeled with its lower bound in microseconds. */
+static void
+print_latency (struct block *block, bool write) 
+{
+  const unsigned long long *h = block->metrics.latency[write];
+  int i;
+
+  printf ("%s: %s latency (us):", block->name, write ? "write" : "read");
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    if (h[i] > 0)
+      printf (" %llu+ %llu", i > 0 ? 1ULL << i : 0ULL, h[i]);
+  printf ("\n");
+}
+
+/* Prints I/O metrics for BLOCK, which must have completed at
+   least one request. */
+static void
+print_metrics (struct block *block) 
+{
+  const struct block_metrics *m = &block->metrics;
+  int64_t elapsed = m->depth_ns - m->first_ns;
+  unsigned long long depth_avg;
+
+  /* Average queue depth, times 100. */
+  depth_avg = elapsed > 0 ? m->depth_area * 100 / elapsed : 0;
+  printf ("%s: %llu requests (%llu%% sequential), "
+          "%llu bytes read, %llu bytes written, "
+          "queue depth %llu.%02llu average, %zu max\n",
+          block->name, m->req_cnt, m->seq_cnt * 100 / m->submit_cnt,
+          m->bytes[0], m->bytes[1], depth_avg / 100, depth_avg % 100,
+          m->depth_max);
+  if (m->bytes[0] > 0)
+    print_latency (block, false);
+  if (m->bytes[1] > 0)
+    print_latency (block, true);
+}
+
+/* Prints the trace buffer, oldest request first, one line per
+   request in the format
+     blktrace: DEVICE R|W SECTOR COUNT SUBMIT ISSUE COMPLETE
+   with the times in nanoseconds since boot. */
+static void
+print_trace (void) 
+{
+  unsigned long long i;
+
+  i = trace_cnt > trace_size ? trace_cnt - trace_size : 0;
+  for (; i < trace_cnt; i++) 
+    {
+      const struct block_trace *t = &trace[i % trace_size];
+      printf ("blktrace: %s %c %"PRDSNu" %zu %"PRId64" %"PRId64" %"PRId64"\n",
+              t->device, t->write ? 'W' : 'R', t->sector, t->cnt,
+              t->submit_ns, t->issue_ns, t->complete_ns);
+    }
+}
+
+/* Stores BLOCK's I/O counts into *STATS.  Reads and writes are
+   counted on every device a request passes through, but
+   transfers only on the device that performs them, so a
+   partition's transfer count is always zero. */
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  stats->read_cnt = block->read_cnt;
+  stats->write_cnt = block->write_cnt;
+  stats->transfer_cnt = block->batch_cnt;
+}
+
+/* Prints statistics for each block device used for a Pintos
+   role, then metrics for each device that has done I/O, then
+   the request trace, if enabled.  Takes no locks, so that it
+   can run during shutdown after a kernel panic. */
 void
 block_print_stats (void)
 {
+  struct list_elem *e;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -171,11 +937,36 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
-          printf ("%s (%s): %llu reads, %llu writes\n",
+          printf ("%s (%s): %llu reads, %llu writes, "
+                  "%llu driver transfers\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  block->read_cnt, block->write_cnt, block->batch_cnt);
         }
     }
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e)) 
+    {
+      struct block *block = list_entry (e, struct block, list_elem);
+      if (block->metrics.req_cnt > 0)
+        print_metrics (block);
+    }
+
+  if (trace != NULL)
+    print_trace ();
+}
+
+/* Enables tracing of the last CNT requests completed on any
+   block device, for printing by block_print_stats(). */
+void
+block_trace_init (size_t cnt) 
+{
+  ASSERT (cnt > 0);
+
+  trace = malloc (cnt * sizeof *trace);
+  if (trace == NULL)
+    PANIC ("couldn't allocate %zu-entry block trace buffer", cnt);
+  trace_size = cnt;
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -188,7 +979,13 @@ block_register (const char *name, enum block_type type,
                 const char *extra_info, block_sector_t size,
                 const struct block_operations *ops, void *aux)
 {
-  struct block *block = malloc (sizeof *block);
+  struct block *block;
+  int i;
+
+  ASSERT (ops->remap != NULL || ops->start != NULL
+          || (ops->read != NULL && ops->write != NULL));
+
+  block = malloc (sizeof *block);
   if (block == NULL)
     PANIC ("Failed to allocate memory for block device descriptor");
 
@@ -200,6 +997,23 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->batch_cnt = 0;
+
+  lock_init (&block->queue.lock);
+  sema_init (&block->queue.wake, 0);
+  list_init (&block->queue.free_batches);
+  list_init (&block->queue.done);
+  for (i = 0; i < BLOCK_IO_CLASS_CNT; i++) 
+    {
+      list_init (&block->queue.sorted[i]);
+      list_init (&block->queue.fifo[i]);
+    }
+  block->queue.pending_cnt = 0;
+  block->queue.head = 0;
+  block->queue.started = false;
+  block->queue.bounce = NULL;
+  block->queue.bounce_busy = false;
+  memset (&block->metrics, 0, sizeof block->metrics);
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
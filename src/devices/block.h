@@ -2,7 +2,9 @@
 #define DEVICES_BLOCK_H
 
 #include <stddef.h>
+#include <stdbool.h>
 #include <inttypes.h>
+#include <list.h>
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -45,6 +47,7 @@ const char *block_type_name (enum block_type);
 struct block *block_get_role (enum block_type);
 void block_set_role (enum block_type, struct block *);
 struct block *block_get_by_name (const char *name);
+bool block_is_within (struct block *, struct block *outer);
 
 struct block *block_first (void);
 struct block *block_next (struct block *);
@@ -53,22 +56,114 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multi (struct block *, block_sector_t, size_t cnt, void *);
+void block_write_multi (struct block *, block_sector_t, size_t cnt,
+                        const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous block device operations. */
+
+struct block_request;
+
+/* I/O scheduling classes.  The dispatcher serves higher classes
+   first, but a request in a lower class that has waited too long
+   is served regardless, so no class starves. */
+enum block_io_class
+  {
+    BLOCK_IO_AUTO,              /* Issuing thread's class, see below. */
+    BLOCK_IO_RT,                /* Realtime: latency-sensitive. */
+    BLOCK_IO_BE,                /* Best effort: normal I/O. */
+    BLOCK_IO_IDLE,              /* Idle: background, nobody waits. */
+    BLOCK_IO_CLASS_CNT
+  };
+
+void block_set_io_class (enum block_io_class);
+
+/* Called when a block request completes.  Runs in the block
+   device's dispatcher thread, so it may acquire locks and sema_up
+   a waiter, but it must not wait for another request on the same
+   device. */
+typedef void block_complete_func (struct block_request *);
+
+/* A request to read or write CNT consecutive sectors.
+   The submitter fills in the first group of members, then must
+   not touch the request until COMPLETE has been called. */
+struct block_request
+  {
+    /* Set by submitter. */
+    bool write;                         /* True to write, false to read. */
+    enum block_io_class io_class;       /* Scheduling class. */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    void *buffer;                       /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    block_complete_func *complete;      /* Called on completion. */
+    void *aux;                          /* For use by COMPLETE. */
+
+    /* Owned by block.c. */
+    struct list_elem sorted_elem;       /* In queue, ordered by sector. */
+    struct list_elem fifo_elem;         /* In queue, ordered by arrival. */
+    struct list_elem batch_elem;        /* In batch being dispatched. */
+    int64_t submitted;                  /* Timer tick when submitted. */
+    int64_t deadline;                   /* Dispatch by this timer tick. */
+    int64_t submit_ns;                  /* timer_nsecs() when submitted. */
+    int64_t issue_ns;                   /* timer_nsecs() when dispatched. */
+  };
+
+void block_submit (struct block *, struct block_request *);
+
 /* Statistics. */
+struct block_stats
+  {
+    unsigned long long read_cnt;        /* Number of sectors read. */
+    unsigned long long write_cnt;       /* Number of sectors written. */
+    unsigned long long transfer_cnt;    /* Number of driver transfers. */
+  };
+
+void block_get_stats (struct block *, struct block_stats *);
 void block_print_stats (void);
+void block_trace_init (size_t cnt);
 
 /* Lower-level interface to block device drivers. */
 
+/* READ and WRITE are required, unless REMAP or START is provided.
+   READ_MULTI and WRITE_MULTI, which
+   transfer CNT consecutive sectors at once, are optional; if a
+   driver leaves them null, multi-sector requests are broken up
+   into single-sector calls.
+
+   If REMAP is non-null, the device is a window onto part of
+   another device, and the block layer does not queue requests to
+   it.  Instead, it calls REMAP to translate *SECTOR and obtain
+   the underlying device, and queues the request there.  The
+   other operations may then be null.
+
+   If START is non-null, the driver transfers asynchronously, and
+   the block layer uses START instead of the other operations.
+   START begins transferring CNT sectors between the device and
+   BUFFER and returns without waiting.  When the transfer is
+   done, the driver calls block_transfer_done() with TAG.  The
+   block layer never has more than a few transfers in flight on a
+   device at once.
+
+   All the operations are called only from the device's
+   dispatcher thread, one at a time. */
 struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+    void (*read_multi) (void *aux, block_sector_t, size_t cnt, void *buffer);
+    void (*write_multi) (void *aux, block_sector_t, size_t cnt,
+                         const void *buffer);
+    struct block *(*remap) (void *aux, block_sector_t *sector);
+    void (*start) (void *aux, bool write, block_sector_t, size_t cnt,
+                   void *buffer, void *tag);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+void block_transfer_done (void *tag);
+enum block_io_class block_transfer_io_class (void *tag);
 
 #endif /* devices/block.h */
@@ -2,16 +2,28 @@
 #include <ctype.h>
 #include <debug.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
+#include "devices/pci.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   If the controller is a PCI bus-master IDE controller, such as
+   the Intel PIIX emulated by QEMU, data is moved by DMA: the
+   driver describes the buffer in a table of "physical region
+   descriptors" (PRDs), starts the transfer, and sleeps until the
+   completion interrupt.  Otherwise, or if a buffer is not
+   suitable for DMA, the CPU copies each sector through the data
+   register ("programmed I/O" or PIO).  See [PIIX] section 2.7. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -33,7 +45,9 @@
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
+#define STA_DF 0x20             /* Device Fault. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +63,52 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+#define CMD_READ_SECTOR_EXT 0x24        /* READ SECTOR EXT. */
+#define CMD_WRITE_SECTOR_EXT 0x34       /* WRITE SECTOR EXT. */
+#define CMD_READ_DMA_EXT 0x25           /* READ DMA EXT. */
+#define CMD_WRITE_DMA_EXT 0x35          /* WRITE DMA EXT. */
+
+/* Sectors addressable by the original 28-bit commands.  Disks
+   that support the 48-bit feature set can go beyond this with
+   the EXT commands. */
+#define LBA28_LIMIT (1UL << 28)
+
+/* Maximum number of sectors in a single ATA command. */
+#define MAX_SECTORS 256
+
+/* Bus master IDE port addresses, relative to the channel's
+   bus master base, which the PCI BIOS assigns. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master Command Register bits. */
+#define BMC_START 0x01          /* Start transfer. */
+#define BMC_READ 0x08           /* 1=device to memory, 0=memory to device. */
+
+/* Bus master Status Register bits.
+   BMS_ERROR and BMS_IRQ are cleared by writing 1 to them. */
+#define BMS_ACTIVE 0x01         /* Transfer in progress. */
+#define BMS_ERROR 0x02          /* Transfer failed. */
+#define BMS_IRQ 0x04            /* Device raised its interrupt. */
+
+/* A physical region descriptor, which tells the bus master
+   controller about one physically contiguous piece of a DMA
+   buffer.  A region may not cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address, even. */
+    uint16_t size;              /* Size in bytes, even; 0 means 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last entry. */
+  };
+
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* A transfer of MAX_SECTORS sectors touches at most this many
+   pages, each of which needs its own PRD. */
+#define PRD_CNT (MAX_SECTORS * BLOCK_SECTOR_SIZE / PGSIZE + 1)
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +117,7 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    bool lba48;                 /* Supports 48-bit addressing? */
   };
 
 /* An ATA channel (aka controller).
@@ -72,6 +133,10 @@ struct channel
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master base I/O port, 0 if no DMA. */
+    struct prd *prdt;           /* PRD table for DMA transfers. */
+    uint8_t bm_status;          /* Bus master status at last interrupt. */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
 
@@ -79,14 +144,36 @@ struct channel
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* A PRD table.  It must not cross a 64 kB boundary.  It is at
+   most 512 bytes long, so aligning each table on a 512-byte
+   boundary guarantees that. */
+struct prd_table
+  {
+    struct prd prds[PRD_CNT];
+  }
+__attribute__ ((aligned (512)));
+
+/* PRD tables, one per channel. */
+static struct prd_table prdts[CHANNEL_CNT];
+
 static struct block_operations ide_operations;
 
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
-static void issue_pio_command (struct channel *, uint8_t command);
+static uint16_t find_bus_master (void);
+
+static void ide_transfer (struct ata_disk *, block_sector_t, void *buffer,
+                          size_t sec_cnt, bool write);
+static void pio_transfer (struct ata_disk *, block_sector_t, void *buffer,
+                          size_t sec_cnt, bool write);
+static void dma_transfer (struct ata_disk *, block_sector_t, void *buffer,
+                          size_t sec_cnt, bool write);
+static bool dma_ok (const struct channel *, const void *buffer);
+
+static bool select_sector (struct ata_disk *, block_sector_t, size_t sec_cnt);
+static void issue_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
@@ -101,8 +188,12 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void) 
 {
+  uint16_t bm_base = find_bus_master ();
   size_t chan_no;
 
+  /* If this fails, a PRD table could cross a 64 kB boundary. */
+  ASSERT (sizeof (struct prd_table) == 512);
+
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
       struct channel *c = &channels[chan_no];
@@ -126,6 +217,9 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+      c->prdt = prdts[chan_no].prds;
+      c->bm_status = 0;
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +230,7 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->lba48 = false;
         }
 
       /* Register interrupt handler. */
@@ -155,6 +250,41 @@ ide_init (void)
     }
 }
 
+/* Looks for a PCI bus-master IDE controller whose channels are
+   at the legacy port addresses and turns on its bus mastering.
+   Returns the controller's bus master base I/O port, or 0 if
+   there is no usable controller, in which case all transfers
+   use PIO. */
+static uint16_t
+find_bus_master (void) 
+{
+  struct pci_address addr;
+  uint32_t class_reg, bar4;
+  uint8_t prog_if;
+
+  if (!pci_find_class (0x01, 0x01, &addr))
+    return 0;
+
+  /* Programming interface bit 7 says whether bus mastering is
+     supported.  Bits 0 and 2 are set if the primary or secondary
+     channel, respectively, is in PCI native mode, in which case
+     it is not at the port addresses we use. */
+  class_reg = pci_read_config (addr, PCI_REG_CLASS);
+  prog_if = class_reg >> 8;
+  if ((prog_if & 0x80) == 0 || (prog_if & 0x05) != 0)
+    return 0;
+
+  /* The bus master registers are in I/O space at BAR4. */
+  bar4 = pci_read_config (addr, PCI_REG_BAR0 + 4 * 4);
+  if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+    return 0;
+
+  pci_write_config (addr, PCI_REG_COMMAND,
+                    (pci_read_config (addr, PCI_REG_COMMAND) & 0xffff)
+                    | PCI_CMD_IO | PCI_CMD_MASTER);
+  return bar4 & 0xfffc;
+}
+
 /* Disk detection and identification. */
 
 static char *descramble_ata_string (char *, int size);
@@ -272,7 +402,7 @@ identify_ata_device (struct ata_disk *d)
      indicating the device's response is ready, and read the data
      into our buffer. */
   select_device_wait (d);
-  issue_pio_command (c, CMD_IDENTIFY_DEVICE);
+  issue_command (c, CMD_IDENTIFY_DEVICE);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     {
@@ -281,23 +411,36 @@ identify_ata_device (struct ata_disk *d)
     }
   input_sector (c, id);
 
-  /* Calculate capacity.
+  /* Calculate capacity, from the 48-bit sector count if the
+     disk supports 48-bit addressing (word 83 bit 10).  Pintos
+     block devices have 32-bit sector numbers, so we use only the
+     first 2 TB of larger disks.
      Read model name and serial number. */
-  capacity = *(uint32_t *) &id[60 * 2];
+  d->lba48 = (*(uint16_t *) &id[83 * 2] & (1u << 10)) != 0;
+  if (d->lba48) 
+    {
+      uint64_t capacity48 = *(uint64_t *) &id[100 * 2];
+      capacity = capacity48 <= (block_sector_t) -1 ? capacity48
+                                                    : (block_sector_t) -1;
+    }
+  else
+    capacity = *(uint32_t *) &id[60 * 2];
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
   snprintf (extra_info, sizeof extra_info,
             "model \"%s\", serial \"%s\"", model, serial);
 
   /* Disable access to IDE disks over 1 GB, which are likely
-     physical IDE disks rather than virtual ones.  If we don't
+     physical IDE disks rather than virtual ones, unless the model
+     name says the disk is emulated by QEMU or Bochs.  If we don't
      allow access to those, we're less likely to scribble on
      someone's important data.  You can disable this check by
      hand if you really want to do so. */
-  if (capacity >= 1024 * 1024 * 1024 / BLOCK_SECTOR_SIZE)
+  if (capacity >= 1024 * 1024 * 1024 / BLOCK_SECTOR_SIZE
+      && memcmp (model, "QEMU", 4) && memcmp (model, "BXHD", 4))
     {
       printf ("%s: ignoring ", d->name);
-      print_human_readable_size (capacity * 512);
+      print_human_readable_size ((uint64_t) capacity * BLOCK_SECTOR_SIZE);
       printf ("disk for safety\n");
       d->is_ata = false;
       return;
@@ -344,16 +487,7 @@ descramble_ata_string (char *string, int size)
 static void
 ide_read (void *d_, block_sector_t sec_no, void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  lock_release (&c->lock);
+  ide_transfer (d_, sec_no, buffer, 1, false);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -364,47 +498,232 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
 static void
 ide_write (void *d_, block_sector_t sec_no, const void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  ide_transfer (d_, sec_no, (void *) buffer, 1, true);
+}
+
+/* Reads the CNT sectors starting at SEC_NO from disk D into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes, using as few ATA commands as possible.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multi (void *d_, block_sector_t sec_no, size_t cnt, void *buffer)
+{
+  uint8_t *p = buffer;
+
+  while (cnt > 0) 
+    {
+      size_t chunk = cnt < MAX_SECTORS ? cnt : MAX_SECTORS;
+      ide_transfer (d_, sec_no, p, chunk, false);
+      sec_no += chunk;
+      p += chunk * BLOCK_SECTOR_SIZE;
+      cnt -= chunk;
+    }
+}
+
+/* Writes the CNT sectors starting at SEC_NO to disk D from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes,
+   using as few ATA commands as possible.  Returns after the disk
+   has acknowledged receiving all the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write_multi (void *d_, block_sector_t sec_no, size_t cnt,
+                 const void *buffer)
+{
+  const uint8_t *p = buffer;
+
+  while (cnt > 0) 
+    {
+      size_t chunk = cnt < MAX_SECTORS ? cnt : MAX_SECTORS;
+      ide_transfer (d_, sec_no, (void *) p, chunk, true);
+      sec_no += chunk;
+      p += chunk * BLOCK_SECTOR_SIZE;
+      cnt -= chunk;
+    }
 }
 
 static struct block_operations ide_operations =
   {
-    ide_read,
-    ide_write
+    .read = ide_read,
+    .write = ide_write,
+    .read_multi = ide_read_multi,
+    .write_multi = ide_write_multi
   };
-
-/* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+
+/* Transfers SEC_CNT sectors, starting at SEC_NO, between disk D
+   and BUFFER, which must have room for SEC_CNT *
+   BLOCK_SECTOR_SIZE bytes.  Writes to the disk if WRITE is true,
+   otherwise reads from it.  Uses DMA if possible, PIO
+   otherwise. */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+ide_transfer (struct ata_disk *d, block_sector_t sec_no, void *buffer,
+              size_t sec_cnt, bool write) 
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < (1UL << 28));
-  
+  ASSERT (sec_cnt > 0 && sec_cnt <= MAX_SECTORS);
+
+  lock_acquire (&c->lock);
+  if (dma_ok (c, buffer))
+    dma_transfer (d, sec_no, buffer, sec_cnt, write);
+  else
+    pio_transfer (d, sec_no, buffer, sec_cnt, write);
+  lock_release (&c->lock);
+}
+
+/* Transfers SEC_CNT sectors between disk D and BUFFER in PIO
+   mode, as described for ide_transfer().  The disk interrupts
+   once per sector: on reads, when the sector's data is ready to
+   be read; on writes, after it has accepted the sector's data. */
+static void
+pio_transfer (struct ata_disk *d, block_sector_t sec_no, void *buffer,
+              size_t sec_cnt, bool write) 
+{
+  struct channel *c = d->channel;
+  uint8_t *p = buffer;
+  size_t i;
+
+  if (!select_sector (d, sec_no, sec_cnt))
+    issue_command (c, write ? CMD_WRITE_SECTOR_RETRY
+                            : CMD_READ_SECTOR_RETRY);
+  else
+    issue_command (c, write ? CMD_WRITE_SECTOR_EXT : CMD_READ_SECTOR_EXT);
+  for (i = 0; i < sec_cnt; i++, p += BLOCK_SECTOR_SIZE)
+    if (!write) 
+      {
+        sema_down (&c->completion_wait);
+        if (!wait_while_busy (d))
+          PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no + i);
+        input_sector (c, p);
+      }
+    else 
+      {
+        if (!wait_while_busy (d))
+          PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no + i);
+        output_sector (c, p);
+        sema_down (&c->completion_wait);
+      }
+}
+
+/* Transfers SEC_CNT sectors between disk D and BUFFER by DMA, as
+   described for ide_transfer().  The CPU is free to run other
+   threads until the disk interrupts at the end of the whole
+   transfer. */
+static void
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, void *buffer,
+              size_t sec_cnt, bool write) 
+{
+  struct channel *c = d->channel;
+  uint8_t direction = write ? 0 : BMC_READ;
+  uint8_t *p = buffer;
+  size_t size = sec_cnt * BLOCK_SECTOR_SIZE;
+  struct prd *prd = c->prdt;
+  bool ext;
+
+  /* Describe BUFFER in the PRD table.  Kernel virtual memory is
+     physically contiguous only within a page, so each page gets
+     its own PRD.  That also keeps every region within a 64 kB
+     boundary. */
+  while (size > 0) 
+    {
+      size_t chunk = PGSIZE - pg_ofs (p);
+      if (chunk > size)
+        chunk = size;
+
+      ASSERT (prd < c->prdt + PRD_CNT);
+      prd->addr = vtop (p);
+      prd->size = chunk;
+      prd->flags = 0;
+      prd++;
+
+      p += chunk;
+      size -= chunk;
+    }
+  prd[-1].flags = PRD_EOT;
+
+  /* Program the bus master controller, clearing stale error and
+     interrupt bits, then issue the command and start the
+     transfer. */
+  ext = select_sector (d, sec_no, sec_cnt);
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c), inb (reg_bm_status (c)) | BMS_ERROR | BMS_IRQ);
+  if (!ext)
+    issue_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  else
+    issue_command (c, write ? CMD_WRITE_DMA_EXT : CMD_READ_DMA_EXT);
+  outb (reg_bm_command (c), direction | BMC_START);
+
+  /* Wait for completion, then stop the bus master. */
+  sema_down (&c->completion_wait);
+  outb (reg_bm_command (c), direction);
+
+  if ((c->bm_status & BMS_ERROR) != 0
+      || (inb (reg_alt_status (c)) & (STA_ERR | STA_DF)) != 0)
+    PANIC ("%s: disk DMA %s failed, sector=%"PRDSNu,
+           d->name, write ? "write" : "read", sec_no);
+}
+
+/* Returns true if BUFFER can be the target of a DMA transfer on
+   channel C. */
+static bool
+dma_ok (const struct channel *c, const void *buffer) 
+{
+  /* The bus master needs even physical addresses, and only
+     kernel virtual addresses have a known physical address. */
+  return (c->bm_base != 0
+          && is_kernel_vaddr (buffer)
+          && ((uintptr_t) buffer & 1) == 0);
+}
+
+/* Selects device D, waiting for it to become ready, and then
+   writes SEC_NO and SEC_CNT to the disk's sector selection
+   registers.  (We use LBA mode.)  Returns false if the transfer
+   should use a 28-bit command, true if it extends past the
+   28-bit limit and so needs a 48-bit EXT command. */
+static bool
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t sec_cnt)
+{
+  struct channel *c = d->channel;
+
+  ASSERT (sec_cnt > 0 && sec_cnt <= MAX_SECTORS);
+
+  if (sec_no + sec_cnt > LBA28_LIMIT) 
+    {
+      uint64_t lba = sec_no;
+
+      /* Each register is a two-byte FIFO: write the high-order
+         bytes first, then the low-order bytes. */
+      ASSERT (d->lba48);
+      select_device_wait (d);
+      outb (reg_nsect (c), sec_cnt >> 8);
+      outb (reg_lbal (c), lba >> 24);
+      outb (reg_lbam (c), lba >> 32);
+      outb (reg_lbah (c), lba >> 40);
+      outb (reg_nsect (c), sec_cnt);
+      outb (reg_lbal (c), lba);
+      outb (reg_lbam (c), lba >> 8);
+      outb (reg_lbah (c), lba >> 16);
+      outb (reg_device (c),
+            DEV_MBS | DEV_LBA | (d->dev_no == 1 ? DEV_DEV : 0));
+      return true;
+    }
+
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), sec_cnt);          /* 256 is written as 0. */
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
   outb (reg_device (c),
         DEV_MBS | DEV_LBA | (d->dev_no == 1 ? DEV_DEV : 0) | (sec_no >> 24));
+  return false;
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
    completion interrupt. */
 static void
-issue_pio_command (struct channel *c, uint8_t command) 
+issue_command (struct channel *c, uint8_t command) 
 {
   /* Interrupts must be enabled or our semaphore will never be
      up'd by the completion handler. */
@@ -513,6 +832,14 @@ interrupt_handler (struct intr_frame *f)
       {
         if (c->expecting_interrupt) 
           {
+            /* Save and clear the bus master status, which
+               dma_transfer() checks for errors. */
+            if (c->bm_base != 0)
+              {
+                c->bm_status = inb (reg_bm_status (c));
+                outb (reg_bm_status (c), c->bm_status | BMS_IRQ);
+              }
+
             inb (reg_status (c));               /* Acknowledge interrupt. */
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
@@ -0,0 +1,165 @@
+#include "devices/pci.h"
+#include <debug.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/io.h"
+
+/* Access to PCI configuration space, using configuration
+   mechanism #1 as found on every PC chipset since the PCI bus
+   was introduced.  See [PCI] chapter 3 for details. */
+
+/* I/O ports. */
+#define PCI_CONFIG_ADDRESS 0xcf8        /* Selects a config register. */
+#define PCI_CONFIG_DATA 0xcfc           /* Data for selected register. */
+
+/* Functions found by pci_init(). */
+#define PCI_DEVICE_MAX 32
+static struct pci_device devices[PCI_DEVICE_MAX];
+static size_t device_cnt;
+
+/* Returns the value to write to PCI_CONFIG_ADDRESS to select
+   register REG of the function at ADDR. */
+static uint32_t
+config_address (struct pci_address addr, uint8_t reg) 
+{
+  ASSERT (addr.slot < 32 && addr.func < 8);
+  ASSERT (reg % 4 == 0);
+
+  return (0x80000000u | ((uint32_t) addr.bus << 16) | (addr.slot << 11)
+          | (addr.func << 8) | reg);
+}
+
+/* Reads and returns the 32-bit configuration register at offset
+   REG of the function at ADDR.  Returns 0xffffffff if no such
+   function exists. */
+uint32_t
+pci_read_config (struct pci_address addr, uint8_t reg) 
+{
+  enum intr_level old_level = intr_disable ();
+  uint32_t value;
+
+  outl (PCI_CONFIG_ADDRESS, config_address (addr, reg));
+  value = inl (PCI_CONFIG_DATA);
+  intr_set_level (old_level);
+
+  return value;
+}
+
+/* Writes VALUE to the 32-bit configuration register at offset
+   REG of the function at ADDR. */
+void
+pci_write_config (struct pci_address addr, uint8_t reg, uint32_t value) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  outl (PCI_CONFIG_ADDRESS, config_address (addr, reg));
+  outl (PCI_CONFIG_DATA, value);
+  intr_set_level (old_level);
+}
+
+/* Searches the functions found by pci_init() for the first one
+   whose class code and subclass are CLASS and SUBCLASS.  If one
+   is found, stores its location in *ADDR and returns true.
+   Otherwise, returns false, as happens on machines without a PCI
+   bus. */
+bool
+pci_find_class (uint8_t class, uint8_t subclass, struct pci_address *addr) 
+{
+  size_t i;
+
+  for (i = 0; i < device_cnt; i++)
+    if (devices[i].class == class && devices[i].subclass == subclass) 
+      {
+        *addr = devices[i].addr;
+        return true;
+      }
+  return false;
+}
+
+/* Returns the IDX'th function, counting from 0, with the given
+   VENDOR and DEVICE IDs, or a null pointer if there are not that
+   many. */
+const struct pci_device *
+pci_find_device (uint16_t vendor, uint16_t device, unsigned idx) 
+{
+  size_t i;
+
+  for (i = 0; i < device_cnt; i++)
+    if (devices[i].vendor == vendor && devices[i].device == device
+        && idx-- == 0)
+      return &devices[i];
+  return NULL;
+}
+
+/* Returns the base I/O port of base address register BAR of
+   device D.  Panics if BAR is not an I/O space BAR. */
+uint32_t
+pci_io_base (const struct pci_device *d, int bar) 
+{
+  uint32_t value;
+
+  ASSERT (bar >= 0 && bar < 6);
+
+  value = pci_read_config (d->addr, PCI_REG_BAR0 + 4 * bar);
+  if ((value & 1) == 0)
+    PANIC ("%02x:%02x.%x: BAR%d is not in I/O space",
+           d->addr.bus, d->addr.slot, d->addr.func, bar);
+  return value & ~3u;
+}
+
+/* Adds the function at ADDR, which exists, to the device table. */
+static void
+add_device (struct pci_address addr) 
+{
+  struct pci_device *d;
+  uint32_t id, class_reg;
+
+  if (device_cnt >= PCI_DEVICE_MAX) 
+    {
+      printf ("pci: too many functions, ignoring %02x:%02x.%x\n",
+              addr.bus, addr.slot, addr.func);
+      return;
+    }
+
+  id = pci_read_config (addr, PCI_REG_ID);
+  class_reg = pci_read_config (addr, PCI_REG_CLASS);
+  d = &devices[device_cnt++];
+  d->addr = addr;
+  d->vendor = id & 0xffff;
+  d->device = id >> 16;
+  d->class = class_reg >> 24;
+  d->subclass = (class_reg >> 16) & 0xff;
+  d->prog_if = (class_reg >> 8) & 0xff;
+  d->irq = pci_read_config (addr, PCI_REG_IRQ) & 0xff;
+}
+
+/* Scans every PCI bus, recording each function found in the
+   device table. */
+void
+pci_init (void) 
+{
+  unsigned bus, slot, func;
+
+  for (bus = 0; bus < 256; bus++)
+    for (slot = 0; slot < 32; slot++) 
+      {
+        struct pci_address a;
+        int func_cnt;
+
+        a.bus = bus;
+        a.slot = slot;
+        a.func = 0;
+        if ((pci_read_config (a, PCI_REG_ID) & 0xffff) == 0xffff)
+          continue;
+
+        /* Only multifunction devices have functions past 0. */
+        func_cnt = pci_read_config (a, PCI_REG_HEADER) & 0x800000 ? 8 : 1;
+        for (func = 0; func < (unsigned) func_cnt; func++) 
+          {
+            a.func = func;
+            if ((pci_read_config (a, PCI_REG_ID) & 0xffff) != 0xffff)
+              add_device (a);
+          }
+      }
+}
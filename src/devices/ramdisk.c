@@ -0,0 +1,134 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A block device whose sectors are kept in kernel memory.
+
+   A RAM disk has no seek or transfer latency, so running the
+   file system on one measures the CPU cost of the file system
+   stack by itself.  Its contents are lost at power off.
+
+   The disk is made of individually allocated pages, so that it
+   does not need a large physically contiguous region. */
+
+/* Number of sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* The RAM disk. */
+struct ramdisk
+  {
+    size_t page_cnt;            /* Number of pages. */
+    uint8_t **pages;            /* Array of PAGE_CNT pages. */
+  };
+
+static struct ramdisk ramdisk;
+
+static struct block_operations ramdisk_operations;
+
+/* Creates a RAM disk named "ram0" of PAGE_CNT pages and registers
+   it as a raw block device, which the -filesys and -swap kernel
+   options can select.  If PRELOAD is non-null, copies as much of
+   PRELOAD's contents into the RAM disk as fits; otherwise the
+   RAM disk starts out zeroed. */
+void
+ramdisk_init (size_t page_cnt, struct block *preload) 
+{
+  struct block *block;
+  size_t i;
+
+  ASSERT (page_cnt > 0);
+
+  ramdisk.page_cnt = page_cnt;
+  ramdisk.pages = malloc (page_cnt * sizeof *ramdisk.pages);
+  if (ramdisk.pages == NULL)
+    PANIC ("ram0: couldn't allocate page array");
+  for (i = 0; i < page_cnt; i++) 
+    {
+      ramdisk.pages[i] = palloc_get_page (PAL_ZERO);
+      if (ramdisk.pages[i] == NULL)
+        PANIC ("ram0: out of memory after %zu of %zu pages", i, page_cnt);
+    }
+
+  block = block_register ("ram0", BLOCK_RAW, "RAM disk",
+                          page_cnt * SECTORS_PER_PAGE,
+                          &ramdisk_operations, &ramdisk);
+
+  if (preload != NULL) 
+    {
+      block_sector_t sector_cnt = block_size (preload);
+      block_sector_t sector;
+
+      if (sector_cnt > block_size (block))
+        sector_cnt = block_size (block);
+      printf ("ram0: loading %'"PRDSNu" sectors from %s\n",
+              sector_cnt, block_name (preload));
+      for (sector = 0; sector < sector_cnt; sector += SECTORS_PER_PAGE) 
+        {
+          block_sector_t cnt = sector_cnt - sector;
+          if (cnt > SECTORS_PER_PAGE)
+            cnt = SECTORS_PER_PAGE;
+          block_read_multi (preload, sector, cnt,
+                            ramdisk.pages[sector / SECTORS_PER_PAGE]);
+        }
+    }
+}
+
+/* Returns the address of SECTOR in RAM disk RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector) 
+{
+  ASSERT (sector / SECTORS_PER_PAGE < rd->page_cnt);
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads the CNT sectors starting at SECTOR from RAM disk RD into
+   BUFFER. */
+static void
+ramdisk_read_multi (void *rd, block_sector_t sector, size_t cnt,
+                    void *buffer) 
+{
+  uint8_t *p = buffer;
+
+  for (; cnt > 0; cnt--, sector++, p += BLOCK_SECTOR_SIZE)
+    memcpy (p, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes the CNT sectors starting at SECTOR to RAM disk RD from
+   BUFFER. */
+static void
+ramdisk_write_multi (void *rd, block_sector_t sector, size_t cnt,
+                     const void *buffer) 
+{
+  const uint8_t *p = buffer;
+
+  for (; cnt > 0; cnt--, sector++, p += BLOCK_SECTOR_SIZE)
+    memcpy (sector_addr (rd, sector), p, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads SECTOR from RAM disk RD into BUFFER. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer) 
+{
+  ramdisk_read_multi (rd, sector, 1, buffer);
+}
+
+/* Writes SECTOR to RAM disk RD from BUFFER. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer) 
+{
+  ramdisk_write_multi (rd, sector, 1, buffer);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    .read = ramdisk_read,
+    .write = ramdisk_write,
+    .read_multi = ramdisk_read_multi,
+    .write_multi = ramdisk_write_multi
+  };
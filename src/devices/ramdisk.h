@@ -0,0 +1,10 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include <stddef.h>
+
+struct block;
+
+void ramdisk_init (size_t page_cnt, struct block *preload);
+
+#endif /* devices/ramdisk.h */
@@ -33,6 +33,14 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear receive and transmit FIFOs. */
+#define FCR_TRIGGER_8 0x80      /* Receive interrupt at 8 bytes. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* FIFOs enabled and working. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -47,6 +55,13 @@
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_TEMT 0x40           /* Transmitter Empty, including shifter. */
+
+/* Transmit FIFO size of the 16550A. */
+#define FIFO_SIZE 16
+
+/* Default data rate, in bits per second. */
+#define DEFAULT_BPS 115200
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
@@ -54,6 +69,14 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Number of bytes the UART accepts each time it reports that
+   its transmitter is empty: FIFO_SIZE if the FIFOs work, 1 on
+   older UARTs without them. */
+static int tx_burst;
+
+/* Data rate, in bits per second. */
+static int serial_bps = DEFAULT_BPS;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
@@ -68,8 +91,9 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
-  set_serial (9600);                    /* 9.6 kbps, N-8-1. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR | FCR_TRIGGER_8); /* Enable FIFO. */
+  tx_burst = (inb (IIR_REG) & IIR_FIFO) == IIR_FIFO ? FIFO_SIZE : 1;
+  set_serial (serial_bps);              /* N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
   intq_init (&txq);
   mode = POLL;
@@ -94,35 +118,81 @@ serial_init_queue (void)
   intr_set_level (old_level);
 }
 
+/* Sets the serial port's data rate to BPS bits per second, which
+   must divide 115,200 evenly.  Returns true if successful, false
+   if BPS is not a supported rate. */
+bool
+serial_set_bps (int bps) 
+{
+  enum intr_level old_level;
+
+  if (bps < 300 || bps > 115200 || 115200 % bps != 0)
+    return false;
+
+  old_level = intr_disable ();
+  serial_bps = bps;
+  if (mode != UNINIT) 
+    {
+      /* Let the byte being sent finish at the old rate. */
+      if (mode == POLL)
+        while ((inb (LSR_REG) & LSR_TEMT) == 0)
+          continue;
+      set_serial (bps);
+    }
+  intr_set_level (old_level);
+  return true;
+}
+
 /* Sends BYTE to the serial port. */
 void
 serial_putc (uint8_t byte) 
+{
+  serial_write (&byte, 1);
+}
+
+/* Sends the CNT bytes in BUF to the serial port.  Disables
+   interrupts once for the whole buffer, rather than once per
+   byte. */
+void
+serial_write (const uint8_t *buf, size_t cnt) 
 {
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit the bytes. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (cnt-- > 0)
+        putc_poll (*buf++); 
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue the bytes and update the interrupt
+         enable register. */
+      while (cnt-- > 0) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (intq_full (&txq)) 
+            {
+              if (old_level == INTR_OFF) 
+                {
+                  /* Interrupts are off and the transmit queue is
+                     full.  If we wanted to wait for the queue to
+                     empty, we'd have to reenable interrupts.
+                     That's impolite, so we'll send a character
+                     via polling instead. */
+                  putc_poll (intq_getc (&txq)); 
+                }
+              else
+                {
+                  /* intq_putc() will wait for the queue to
+                     drain, so make sure that it does. */
+                  write_ier ();
+                }
+            }
+          intq_putc (&txq, *buf++); 
         }
-
-      intq_putc (&txq, byte); 
       write_ier ();
     }
   
@@ -218,10 +288,15 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If we have bytes to transmit, and the transmitter is empty,
+     refill it: the whole FIFO at once, if there is one. */
+  if (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
+    {
+      int i;
+
+      for (i = 0; i < tx_burst && !intq_empty (&txq); i++)
+        outb (THR_REG, intq_getc (&txq));
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -0,0 +1,217 @@
+#include "devices/stripe.h"
+#include <debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+
+/* A striped ("RAID-0") block device, which spreads its sectors
+   across several member devices in round-robin fashion, CHUNK
+   sectors at a time.  With members A and B and a chunk size of
+   4, sectors 0...3 are on A, 4...7 on B, 8...11 on A, and so
+   on.
+
+   The device transfers asynchronously: a batch handed over by
+   the block layer is split at chunk boundaries into requests to
+   the members, which each member's dispatcher carries out
+   independently.  Thus, with members on different IDE channels,
+   a large transfer keeps both channels busy at once. */
+
+/* Maximum number of member devices. */
+#define MEMBER_MAX 8
+
+/* Default chunk size, in sectors. */
+#define DEFAULT_CHUNK 32
+
+/* The striped device. */
+struct stripe
+  {
+    struct block *members[MEMBER_MAX];  /* Member devices. */
+    size_t member_cnt;                  /* Number of members. */
+    block_sector_t chunk;               /* Sectors per chunk. */
+  };
+
+/* A transfer in progress, split into one request per chunk. */
+struct stripe_io
+  {
+    void *tag;                  /* For block_transfer_done(). */
+    size_t pending;             /* Requests not yet complete. */
+    struct block_request reqs[]; /* Requests to members. */
+  };
+
+static struct stripe stripe;
+
+static struct block_operations stripe_operations;
+
+/* Creates striped device "md0" as described by SPEC, which has
+   the form DEV,DEV[,DEV...][:KB], where each DEV names a member
+   device and KB is the chunk size in kB.  Panics if SPEC is
+   invalid or names a device that has a role, such as scratch,
+   or that contains a partition with a role or the kernel.
+   Returns the new device. */
+struct block *
+stripe_init (char *spec) 
+{
+  block_sector_t member_size;
+  char *devs, *chunk, *name, *save_ptr;
+  char extra_info[64];
+  size_t i;
+
+  devs = strtok_r (spec, ":", &save_ptr);
+  chunk = strtok_r (NULL, "", &save_ptr);
+  stripe.chunk = DEFAULT_CHUNK;
+  if (chunk != NULL)
+    {
+      int kb = atoi (chunk);
+      if (kb <= 0)
+        PANIC ("md0: bad chunk size \"%s\"", chunk);
+      stripe.chunk = kb * (1024 / BLOCK_SECTOR_SIZE);
+    }
+
+  for (name = strtok_r (devs, ",", &save_ptr); name != NULL;
+       name = strtok_r (NULL, ",", &save_ptr)) 
+    {
+      struct block *member = block_get_by_name (name);
+      struct block *b;
+      int role;
+
+      if (member == NULL)
+        PANIC ("md0: no such block device \"%s\"", name);
+      if (stripe.member_cnt >= MEMBER_MAX)
+        PANIC ("md0: more than %d members", MEMBER_MAX);
+      for (i = 0; i < stripe.member_cnt; i++)
+        if (stripe.members[i] == member)
+          PANIC ("md0: %s listed twice", name);
+      for (role = 0; role < BLOCK_ROLE_CNT; role++)
+        if (block_get_role (role) != NULL
+            && block_is_within (block_get_role (role), member))
+          PANIC ("md0: %s holds the %s device %s", name,
+                 block_type_name (role), block_name (block_get_role (role)));
+      for (b = block_first (); b != NULL; b = block_next (b))
+        if (block_type (b) == BLOCK_KERNEL && block_is_within (b, member))
+          PANIC ("md0: %s holds the kernel in %s", name, block_name (b));
+      stripe.members[stripe.member_cnt++] = member;
+    }
+  if (stripe.member_cnt < 2)
+    PANIC ("md0: at least two member devices required");
+
+  /* Use the same number of whole chunks from each member. */
+  member_size = block_size (stripe.members[0]);
+  for (i = 1; i < stripe.member_cnt; i++)
+    if (block_size (stripe.members[i]) < member_size)
+      member_size = block_size (stripe.members[i]);
+  member_size -= member_size % stripe.chunk;
+  if (member_size == 0)
+    PANIC ("md0: members smaller than one chunk");
+
+  snprintf (extra_info, sizeof extra_info, "%zu-way stripe, %"PRDSNu" kB "
+            "chunks", stripe.member_cnt,
+            stripe.chunk * BLOCK_SECTOR_SIZE / 1024);
+  return block_register ("md0", BLOCK_RAW, extra_info,
+                         member_size * stripe.member_cnt,
+                         &stripe_operations, &stripe);
+}
+
+/* Returns true if BLOCK is a member of md0 or a partition of
+   one, false otherwise. */
+bool
+stripe_has_member (struct block *block) 
+{
+  size_t i;
+
+  for (i = 0; i < stripe.member_cnt; i++)
+    if (block_is_within (block, stripe.members[i]))
+      return true;
+  return false;
+}
+
+/* Translates SECTOR on striped device S into a member device,
+   which is returned, and a sector on it, stored in *MEMBER_SECTOR. */
+static struct block *
+map_sector (const struct stripe *s, block_sector_t sector,
+            block_sector_t *member_sector) 
+{
+  block_sector_t chunk_no = sector / s->chunk;
+
+  *member_sector = chunk_no / s->member_cnt * s->chunk + sector % s->chunk;
+  return s->members[chunk_no % s->member_cnt];
+}
+
+/* Completion function for a request to a member device.  Calls
+   block_transfer_done() when the whole transfer is complete. */
+static void
+member_complete (struct block_request *r) 
+{
+  struct stripe_io *io = r->aux;
+  enum intr_level old_level;
+  bool done;
+
+  /* Members complete requests from their own dispatcher
+     threads, so several may get here at once. */
+  old_level = intr_disable ();
+  done = --io->pending == 0;
+  intr_set_level (old_level);
+
+  if (done) 
+    {
+      void *tag = io->tag;
+      free (io);
+      block_transfer_done (tag);
+    }
+}
+
+/* Starts transferring CNT sectors at SECTOR on striped device
+   S_ between BUFFER and the member devices. */
+static void
+stripe_start (void *s_, bool write, block_sector_t sector, size_t cnt,
+              void *buffer, void *tag) 
+{
+  struct stripe *s = s_;
+  size_t piece_cnt = ((sector + cnt - 1) / s->chunk - sector / s->chunk) + 1;
+  enum block_io_class io_class = block_transfer_io_class (tag);
+  struct stripe_io *io;
+  uint8_t *p = buffer;
+  size_t i;
+
+  io = malloc (sizeof *io + piece_cnt * sizeof *io->reqs);
+  if (io == NULL)
+    PANIC ("md0: out of memory");
+  io->tag = tag;
+  io->pending = piece_cnt;
+
+  /* Set up every request before submitting any, since the last
+     one to complete frees IO.  Until then, each request's SECTOR
+     is a sector on the striped device. */
+  for (i = 0; i < piece_cnt; i++) 
+    {
+      struct block_request *r = &io->reqs[i];
+      size_t n = s->chunk - sector % s->chunk;
+
+      if (n > cnt)
+        n = cnt;
+      r->write = write;
+      r->io_class = io_class;
+      r->sector = sector;
+      r->cnt = n;
+      r->buffer = p;
+      r->complete = member_complete;
+      r->aux = io;
+      sector += n;
+      cnt -= n;
+      p += n * BLOCK_SECTOR_SIZE;
+    }
+  ASSERT (cnt == 0);
+
+  for (i = 0; i < piece_cnt; i++) 
+    {
+      struct block_request *r = &io->reqs[i];
+      block_submit (map_sector (s, r->sector, &r->sector), r);
+    }
+}
+
+static struct block_operations stripe_operations =
+  {
+    .start = stripe_start
+  };
@@ -24,11 +24,22 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Number of CPU timestamp counter cycles per second, and the
+   counter's value at calibration.  Initialized by
+   timer_calibrate(). */
+static uint64_t tsc_per_sec;
+static uint64_t tsc_base;
+
+/* Number of timer ticks over which timer_calibrate() measures
+   the timestamp counter. */
+#define TSC_CALIBRATE_TICKS 4
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static uint64_t rdtsc (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -64,6 +75,24 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  /* Measure the timestamp counter's rate against the timer, for
+     timer_nsecs(). */
+  {
+    int64_t start = ticks;
+    uint64_t tsc_start;
+
+    while (ticks == start)
+      barrier ();
+    start = ticks;
+    tsc_start = rdtsc ();
+    while (ticks < start + TSC_CALIBRATE_TICKS)
+      barrier ();
+    tsc_base = rdtsc ();
+    tsc_per_sec = ((tsc_base - tsc_start) * TIMER_FREQ
+                   / TSC_CALIBRATE_TICKS);
+    tsc_base -= (uint64_t) ticks * (tsc_per_sec / TIMER_FREQ);
+  }
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -76,6 +105,25 @@ timer_ticks (void)
   return t;
 }
 
+/* Returns the number of nanoseconds since the OS booted, with
+   the resolution of the CPU's timestamp counter.  Before
+   timer_calibrate() has run, the resolution is one timer
+   tick. */
+int64_t
+timer_nsecs (void) 
+{
+  uint64_t tsc;
+
+  if (tsc_per_sec == 0)
+    return timer_ticks () * (1000 * 1000 * 1000 / TIMER_FREQ);
+
+  /* Split the conversion so that the multiplication cannot
+     overflow. */
+  tsc = rdtsc () - tsc_base;
+  return (tsc / tsc_per_sec * 1000000000
+          + tsc % tsc_per_sec * 1000000000 / tsc_per_sec);
+}
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -203,6 +251,16 @@ busy_wait (int64_t loops)
     barrier ();
 }
 
+/* Returns the CPU's timestamp counter, which counts clock cycles
+   since reset. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Sleep for approximately NUM/DENOM seconds. */
 static void
 real_time_sleep (int64_t num, int32_t denom) 
@@ -8,28 +8,46 @@
 #include "threads/interrupt.h"
 #include "threads/vaddr.h"
 
-/* VGA text screen support.  See [FREEVGA] for more information. */
+/* VGA text screen support.  See [FREEVGA] for more information.
+
+   The screen shows ROW_CNT rows of the 32 kB of text-mode video
+   memory, starting at the row selected by the CRTC start address
+   register.  The screen is thus a window that slides down
+   through FB_ROWS rows of video memory: we scroll by moving the
+   start address down one row, so that scrolling costs only
+   clearing the new bottom row.  When the window reaches the end
+   of video memory, we copy the rows still on screen back to the
+   beginning and start over, which happens only once every
+   FB_ROWS - ROW_CNT lines. */
 
 /* Number of columns and rows on the text display. */
 #define COL_CNT 80
 #define ROW_CNT 25
 
+/* Number of rows in video memory. */
+#define FB_ROWS (0x8000 / (COL_CNT * 2))
+
 /* Current cursor position.  (0,0) is in the upper left corner of
    the display. */
 static size_t cx, cy;
 
+/* Row of video memory displayed at the top of the screen. */
+static size_t top;
+
 /* Attribute value for gray text on a black background. */
 #define GRAY_ON_BLACK 0x07
 
-/* Framebuffer.  See [FREEVGA] under "VGA Text Mode Operation".
-   The character at (x,y) is fb[y][x][0].
-   The attribute at (x,y) is fb[y][x][1]. */
+/* Framebuffer: all of video memory.  See [FREEVGA] under "VGA
+   Text Mode Operation".
+   The character at screen position (x,y) is fb[top + y][x][0].
+   The attribute at screen position (x,y) is fb[top + y][x][1]. */
 static uint8_t (*fb)[COL_CNT][2];
 
+static void putc_raw (int c, enum intr_level old_level);
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
-static void move_cursor (void);
+static void update_crtc (void);
 static void find_cursor (size_t *x, size_t *y);
 
 /* Initializes the VGA text display. */
@@ -50,13 +68,38 @@ init (void)
    characters in the conventional ways.  */
 void
 vga_putc (int c)
+{
+  char ch = c;
+  vga_write (&ch, 1);
+}
+
+/* Writes the CNT characters in BUF to the VGA text display,
+   interpreting control characters in the conventional ways.
+   Updates the hardware cursor and start address once, at the
+   end. */
+void
+vga_write (const char *buf, size_t cnt)
 {
   /* Disable interrupts to lock out interrupt handlers
      that might write to the console. */
   enum intr_level old_level = intr_disable ();
 
   init ();
-  
+  while (cnt-- > 0)
+    putc_raw (*buf++, old_level);
+
+  /* Update start address and cursor position. */
+  update_crtc ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes C to the VGA text display, without updating the CRTC.
+   Interrupts must be off; OLD_LEVEL is the level to restore
+   while beeping. */
+static void
+putc_raw (int c, enum intr_level old_level)
+{
   switch (c) 
     {
     case '\n':
@@ -89,17 +132,12 @@ vga_putc (int c)
       break;
       
     default:
-      fb[cy][cx][0] = c;
-      fb[cy][cx][1] = GRAY_ON_BLACK;
+      fb[top + cy][cx][0] = c;
+      fb[top + cy][cx][1] = GRAY_ON_BLACK;
       if (++cx >= COL_CNT)
         newline ();
       break;
     }
-
-  /* Update cursor position. */
-  move_cursor ();
-
-  intr_set_level (old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
@@ -108,14 +146,14 @@ cls (void)
 {
   size_t y;
 
+  top = 0;
   for (y = 0; y < ROW_CNT; y++)
     clear_row (y);
 
   cx = cy = 0;
-  move_cursor ();
 }
 
-/* Clears row Y to spaces. */
+/* Clears screen row Y to spaces. */
 static void
 clear_row (size_t y) 
 {
@@ -123,8 +161,8 @@ clear_row (size_t y)
 
   for (x = 0; x < COL_CNT; x++)
     {
-      fb[y][x][0] = ' ';
-      fb[y][x][1] = GRAY_ON_BLACK;
+      fb[top + y][x][0] = ' ';
+      fb[top + y][x][1] = GRAY_ON_BLACK;
     }
 }
 
@@ -139,27 +177,48 @@ newline (void)
   if (cy >= ROW_CNT)
     {
       cy = ROW_CNT - 1;
-      memmove (&fb[0], &fb[1], sizeof fb[0] * (ROW_CNT - 1));
+      if (top + ROW_CNT >= FB_ROWS) 
+        {
+          /* Out of video memory below the screen.  Move the
+             rows that stay on screen back to the beginning. */
+          memmove (&fb[0], &fb[top + 1], sizeof fb[0] * (ROW_CNT - 1));
+          top = 0;
+        }
+      else
+        top++;
       clear_row (ROW_CNT - 1);
     }
 }
 
-/* Moves the hardware cursor to (cx,cy). */
+/* Points the CRTC start address at row TOP and moves the
+   hardware cursor to (cx,cy). */
 static void
-move_cursor (void) 
+update_crtc (void) 
 {
-  /* See [FREEVGA] under "Manipulating the Text-mode Cursor". */
-  uint16_t cp = cx + COL_CNT * cy;
+  /* See [FREEVGA] under "Manipulating the Text-mode Cursor" and
+     the CRTC Start Address registers. */
+  uint16_t start = COL_CNT * top;
+  uint16_t cp = start + cx + COL_CNT * cy;
+  outw (0x3d4, 0x0c | (start & 0xff00));
+  outw (0x3d4, 0x0d | (start << 8));
   outw (0x3d4, 0x0e | (cp & 0xff00));
   outw (0x3d4, 0x0f | (cp << 8));
 }
 
-/* Reads the current hardware cursor position into (*X,*Y). */
+/* Reads the current hardware cursor position, relative to the
+   start of the screen, into (*X,*Y), and the row at the start of
+   the screen into TOP. */
 static void
 find_cursor (size_t *x, size_t *y) 
 {
   /* See [FREEVGA] under "Manipulating the Text-mode Cursor". */
-  uint16_t cp;
+  uint16_t start, cp;
+
+  outb (0x3d4, 0x0c);
+  start = inb (0x3d5) << 8;
+
+  outb (0x3d4, 0x0d);
+  start |= inb (0x3d5);
 
   outb (0x3d4, 0x0e);
   cp = inb (0x3d5) << 8;
@@ -167,6 +226,11 @@ find_cursor (size_t *x, size_t *y)
   outb (0x3d4, 0x0f);
   cp |= inb (0x3d5);
 
+  top = start / COL_CNT;
+  if (top + ROW_CNT > FB_ROWS || cp < start)
+    top = 0;
   *x = cp % COL_CNT;
-  *y = cp / COL_CNT;
+  *y = (cp - COL_CNT * top) / COL_CNT;
+  if (*y >= ROW_CNT)
+    *y = ROW_CNT - 1;
 }
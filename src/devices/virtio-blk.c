@@ -0,0 +1,399 @@
+#include "devices/virtio-blk.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/partition.h"
+#include "devices/pci.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Driver for virtio block devices, such as QEMU's "-drive
+   if=virtio", using the legacy PCI interface described in
+   [VIRTIO] section 2 and appendix D.
+
+   The driver and the device communicate through a "virtqueue"
+   in memory.  To issue a request, the driver fills in a chain of
+   descriptors that point to a request header, the data buffer,
+   and a status byte, places the head of the chain in the
+   "available" ring, and notifies the device.  The device
+   carries out the request, places the head of the chain in the
+   "used" ring, and raises an interrupt.  Unlike an IDE channel,
+   the device accepts many requests at once, so the block layer
+   keeps several transfers in flight and the device may reorder
+   them. */
+
+/* PCI IDs of a legacy virtio block device. */
+#define VIRTIO_VENDOR 0x1af4
+#define VIRTIO_BLK_DEVICE 0x1001
+
+/* Legacy virtio I/O port addresses, relative to BAR0. */
+#define reg_host_features(D) ((D)->io_base + 0x00)  /* Device features. */
+#define reg_guest_features(D) ((D)->io_base + 0x04) /* Driver features. */
+#define reg_queue_pfn(D) ((D)->io_base + 0x08)      /* Ring page number. */
+#define reg_queue_size(D) ((D)->io_base + 0x0c)     /* Ring size (r/o). */
+#define reg_queue_select(D) ((D)->io_base + 0x0e)   /* Selects a queue. */
+#define reg_queue_notify(D) ((D)->io_base + 0x10)   /* Kicks a queue. */
+#define reg_status(D) ((D)->io_base + 0x12)         /* Device status. */
+#define reg_isr(D) ((D)->io_base + 0x13)            /* ISR status, r/c. */
+#define reg_capacity(D) ((D)->io_base + 0x14)       /* Capacity, 64 bits. */
+
+/* Device status bits. */
+#define STATUS_ACKNOWLEDGE 0x01 /* Guest has noticed the device. */
+#define STATUS_DRIVER 0x02      /* Guest knows how to drive it. */
+#define STATUS_DRIVER_OK 0x04   /* Driver is ready. */
+#define STATUS_FAILED 0x80      /* Driver gave up on the device. */
+
+/* A virtqueue descriptor. */
+struct vring_desc
+  {
+    uint64_t addr;              /* Physical address of buffer. */
+    uint32_t len;               /* Length of buffer in bytes. */
+    uint16_t flags;             /* VRING_DESC_F_*. */
+    uint16_t next;              /* Next descriptor, if F_NEXT. */
+  };
+
+#define VRING_DESC_F_NEXT 1     /* Chain continues with NEXT. */
+#define VRING_DESC_F_WRITE 2    /* Device writes buffer (else reads). */
+
+/* The ring of descriptor chains offered to the device. */
+struct vring_avail
+  {
+    uint16_t flags;
+    uint16_t idx;               /* Where the driver adds the next entry. */
+    uint16_t ring[];            /* Heads of descriptor chains. */
+  };
+
+/* An entry in the used ring. */
+struct vring_used_elem
+  {
+    uint32_t id;                /* Head of descriptor chain. */
+    uint32_t len;               /* Bytes written into the chain. */
+  };
+
+/* The ring of descriptor chains the device has finished with. */
+struct vring_used
+  {
+    uint16_t flags;
+    uint16_t idx;               /* Where the device adds the next entry. */
+    struct vring_used_elem ring[];
+  };
+
+/* Legacy devices require the used ring to start on a page
+   boundary after the descriptors and available ring. */
+#define VRING_ALIGN PGSIZE
+
+/* Request header, followed by the data and a status byte. */
+struct virtio_blk_header
+  {
+    uint32_t type;              /* VIRTIO_BLK_T_*. */
+    uint32_t ioprio;            /* Ignored by the device. */
+    uint64_t sector;            /* First sector. */
+  };
+
+#define VIRTIO_BLK_T_IN 0       /* Read. */
+#define VIRTIO_BLK_T_OUT 1      /* Write. */
+
+#define VIRTIO_BLK_S_OK 0       /* Request succeeded. */
+
+/* Each request uses a chain of three descriptors. */
+#define DESC_PER_REQUEST 3
+
+/* Maximum number of requests outstanding on one device.  The
+   block layer does not ask for more than a few at once. */
+#define SLOT_CNT 16
+
+/* An outstanding request.  Slot I uses descriptors
+   I * DESC_PER_REQUEST through I * DESC_PER_REQUEST + 2. */
+struct request_slot
+  {
+    struct virtio_blk_header header;    /* Read by device. */
+    uint8_t status;                     /* Written by device. */
+    bool in_use;                        /* Slot allocated? */
+    void *tag;                          /* For block_transfer_done(). */
+  };
+
+/* A virtio block device. */
+struct virtio_disk
+  {
+    char name[8];               /* Name, e.g. "vda". */
+    uint16_t io_base;           /* Base I/O port, from BAR0. */
+    uint8_t irq;                /* Interrupt vector. */
+
+    /* Virtqueue. */
+    uint16_t queue_size;        /* Number of descriptors. */
+    size_t ring_pages;          /* Pages allocated for the rings. */
+    struct vring_desc *desc;    /* Descriptor table. */
+    struct vring_avail *avail;  /* Available ring. */
+    struct vring_used *used;    /* Used ring. */
+    uint16_t last_used;         /* Used ring entries already reaped. */
+
+    /* Request slots.  Allocated with interrupts off, because the
+       interrupt handler frees them. */
+    struct request_slot *slots; /* One page. */
+    size_t slot_cnt;            /* Number of usable slots. */
+    struct semaphore free_slots;        /* Counts free slots. */
+  };
+
+/* We support up to this many devices, named "vda" onward. */
+#define DISK_MAX 4
+static struct virtio_disk disks[DISK_MAX];
+static size_t disk_cnt;
+
+static struct block_operations virtio_blk_operations;
+
+static bool init_disk (struct virtio_disk *, const struct pci_device *);
+static bool irq_in_use (uint8_t irq, size_t cnt);
+static void interrupt_handler (struct intr_frame *);
+
+/* Detects virtio block devices on the PCI bus and registers
+   each one and its partitions. */
+void
+virtio_blk_init (void) 
+{
+  const struct pci_device *pd;
+  size_t i;
+
+  for (i = 0; (pd = pci_find_device (VIRTIO_VENDOR, VIRTIO_BLK_DEVICE, i))
+              != NULL; i++) 
+    {
+      struct virtio_disk *d;
+      struct block *block;
+      uint64_t capacity;
+      char extra_info[32];
+
+      if (disk_cnt >= DISK_MAX) 
+        {
+          printf ("virtio-blk: ignoring devices after %zu\n", disk_cnt);
+          break;
+        }
+      d = &disks[disk_cnt];
+      snprintf (d->name, sizeof d->name, "vd%c", 'a' + (int) disk_cnt);
+      if (!init_disk (d, pd))
+        continue;
+      disk_cnt++;
+
+      /* Devices sharing an interrupt line share a handler. */
+      if (!irq_in_use (d->irq, disk_cnt - 1))
+        intr_register_ext (d->irq, interrupt_handler, "virtio-blk");
+
+      capacity = inl (reg_capacity (d))
+                 | (uint64_t) inl (reg_capacity (d) + 4) << 32;
+      if (capacity > (block_sector_t) -1) 
+        {
+          printf ("%s: using only first %"PRDSNu" sectors\n",
+                  d->name, (block_sector_t) -1);
+          capacity = (block_sector_t) -1;
+        }
+
+      snprintf (extra_info, sizeof extra_info, "virtio %02x:%02x.%x",
+                pd->addr.bus, pd->addr.slot, pd->addr.func);
+      block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
+                              &virtio_blk_operations, d);
+      partition_scan (block);
+    }
+}
+
+/* Returns true if any of the first CNT disks uses interrupt
+   vector IRQ. */
+static bool
+irq_in_use (uint8_t irq, size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (disks[i].irq == irq)
+      return true;
+  return false;
+}
+
+/* Resets the device described by PD, sets up its virtqueue, and
+   initializes D to drive it.  Returns true if successful,
+   false if the device cannot be used. */
+static bool
+init_disk (struct virtio_disk *d, const struct pci_device *pd) 
+{
+  size_t avail_end;
+  size_t i;
+
+  /* Let the device respond to I/O and do DMA. */
+  pci_write_config (pd->addr, PCI_REG_COMMAND,
+                    (pci_read_config (pd->addr, PCI_REG_COMMAND) & 0xffff)
+                    | PCI_CMD_IO | PCI_CMD_MASTER);
+  if (pd->irq >= 16) 
+    {
+      printf ("%s: no interrupt line assigned\n", d->name);
+      return false;
+    }
+  d->io_base = pci_io_base (pd, 0);
+  d->irq = pd->irq + 0x20;
+
+  /* Reset, then say hello.  We need none of the optional
+     features. */
+  outb (reg_status (d), 0);
+  outb (reg_status (d), STATUS_ACKNOWLEDGE);
+  outb (reg_status (d), STATUS_ACKNOWLEDGE | STATUS_DRIVER);
+  outl (reg_guest_features (d), 0);
+
+  /* Set up queue 0, the only one a block device has. */
+  outw (reg_queue_select (d), 0);
+  d->queue_size = inw (reg_queue_size (d));
+  if (d->queue_size == 0 || inl (reg_queue_pfn (d)) != 0) 
+    {
+      printf ("%s: request queue unavailable\n", d->name);
+      outb (reg_status (d), STATUS_FAILED);
+      return false;
+    }
+  avail_end = (sizeof *d->desc * d->queue_size + sizeof *d->avail
+               + sizeof d->avail->ring[0] * (d->queue_size + 1));
+  d->ring_pages = (DIV_ROUND_UP (avail_end, VRING_ALIGN) * VRING_ALIGN
+                   + sizeof *d->used
+                   + sizeof d->used->ring[0] * d->queue_size
+                   + sizeof (uint16_t));
+  d->ring_pages = DIV_ROUND_UP (d->ring_pages, PGSIZE);
+  d->desc = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, d->ring_pages);
+  d->avail = (struct vring_avail *) (d->desc + d->queue_size);
+  d->used = (struct vring_used *) ((uint8_t *) d->desc
+                                   + ROUND_UP (avail_end, VRING_ALIGN));
+  d->last_used = 0;
+
+  /* Set up request slots, with each slot's descriptors chained
+     together once and for all. */
+  d->slots = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  d->slot_cnt = d->queue_size / DESC_PER_REQUEST;
+  if (d->slot_cnt > SLOT_CNT)
+    d->slot_cnt = SLOT_CNT;
+  sema_init (&d->free_slots, d->slot_cnt);
+  for (i = 0; i < d->slot_cnt; i++) 
+    {
+      struct request_slot *s = &d->slots[i];
+      struct vring_desc *desc = &d->desc[i * DESC_PER_REQUEST];
+
+      desc[0].addr = vtop (&s->header);
+      desc[0].len = sizeof s->header;
+      desc[0].flags = VRING_DESC_F_NEXT;
+      desc[0].next = i * DESC_PER_REQUEST + 1;
+      desc[1].next = i * DESC_PER_REQUEST + 2;
+      desc[2].addr = vtop (&s->status);
+      desc[2].len = sizeof s->status;
+      desc[2].flags = VRING_DESC_F_WRITE;
+    }
+
+  outl (reg_queue_pfn (d), vtop (d->desc) / PGSIZE);
+  outb (reg_status (d),
+        STATUS_ACKNOWLEDGE | STATUS_DRIVER | STATUS_DRIVER_OK);
+  return true;
+}
+
+/* Allocates and returns a free request slot in D, waiting for
+   one if necessary. */
+static struct request_slot *
+alloc_slot (struct virtio_disk *d) 
+{
+  enum intr_level old_level;
+  size_t i;
+
+  sema_down (&d->free_slots);
+  old_level = intr_disable ();
+  for (i = 0; i < d->slot_cnt; i++)
+    if (!d->slots[i].in_use) 
+      {
+        d->slots[i].in_use = true;
+        intr_set_level (old_level);
+        return &d->slots[i];
+      }
+  NOT_REACHED ();
+}
+
+/* Starts a transfer of CNT sectors beginning at SECTOR between
+   the device D_ and BUFFER.  The interrupt handler reports its
+   completion to the block layer with TAG. */
+static void
+virtio_blk_start (void *d_, bool write, block_sector_t sector, size_t cnt,
+                  void *buffer, void *tag) 
+{
+  struct virtio_disk *d = d_;
+  struct request_slot *s;
+  struct vring_desc *data;
+  uint16_t head;
+
+  /* The kernel maps physical memory contiguously, so a kernel
+     buffer needs just one descriptor. */
+  ASSERT (is_kernel_vaddr (buffer));
+
+  s = alloc_slot (d);
+  s->header.type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+  s->header.ioprio = 0;
+  s->header.sector = sector;
+  s->status = 0xff;
+  s->tag = tag;
+
+  head = (s - d->slots) * DESC_PER_REQUEST;
+  data = &d->desc[head + 1];
+  data->addr = vtop (buffer);
+  data->len = cnt * BLOCK_SECTOR_SIZE;
+  data->flags = VRING_DESC_F_NEXT | (write ? 0 : VRING_DESC_F_WRITE);
+
+  /* Only this function adds to the available ring, and the
+     block layer calls it from a single thread, so no locking is
+     needed.  The device must see the descriptors before the new
+     ring entry, and the entry before the index. */
+  d->avail->ring[d->avail->idx % d->queue_size] = head;
+  barrier ();
+  d->avail->idx++;
+  barrier ();
+  outw (reg_queue_notify (d), 0);
+}
+
+/* Reaps the requests that device D has finished. */
+static void
+reap_used (struct virtio_disk *d) 
+{
+  while (d->last_used != *(volatile uint16_t *) &d->used->idx) 
+    {
+      struct vring_used_elem *e
+        = &d->used->ring[d->last_used % d->queue_size];
+      struct request_slot *s = &d->slots[e->id / DESC_PER_REQUEST];
+      void *tag = s->tag;
+
+      barrier ();
+      if (s->status != VIRTIO_BLK_S_OK)
+        PANIC ("%s: %s of sector %"PRIu64" failed with status %d",
+               d->name,
+               s->header.type == VIRTIO_BLK_T_OUT ? "write" : "read",
+               s->header.sector, s->status);
+
+      d->last_used++;
+      s->in_use = false;
+      sema_up (&d->free_slots);
+      block_transfer_done (tag);
+    }
+}
+
+/* Virtio block interrupt handler. */
+static void
+interrupt_handler (struct intr_frame *f) 
+{
+  size_t i;
+
+  for (i = 0; i < disk_cnt; i++) 
+    {
+      struct virtio_disk *d = &disks[i];
+
+      /* Reading the ISR status register acknowledges the
+         interrupt. */
+      if (d->irq == f->vec_no && (inb (reg_isr (d)) & 1))
+        reap_used (d);
+    }
+}
+
+static struct block_operations virtio_blk_operations =
+  {
+    .start = virtio_blk_start
+  };
@@ -1,5 +1,9 @@
 #include "filesys/cache.h"
 
+/* The buffer cache holds file system blocks, each fs_block_size
+   bytes long.  In this file, a "sector" is a file system block
+   number, which the cache translates into device sectors. */
+
 /* cache_data contains the metadata for a single cache slot. */
 struct cache_data
   {
@@ -10,19 +14,29 @@ struct cache_data
                          replace the current one after eviction. -1 if the
                          slot is not being evicted. */
     struct lock lock; /* Lock for synchronizing access to the slot. */
+    bool flushing;    /* Whether cache_flush() is writing a copy of the
+                         slot to disk. */
+    struct semaphore flushed;   /* Upped when that write completes. */
   };
 
-/* cache_block provides a convenient way to declare and access
-   BLOCK_SECTOR_SIZE chunks of data. */
-struct cache_block
-  {
-    char data[BLOCK_SECTOR_SIZE];
-  };
+/* Number of slots that cache_flush() copies and writes at a time. */
+#define FLUSH_BATCH 16
 
 static struct lock cache_lock;                /* Cache metadata lock. */
-static struct lock io_lock;                   /* Block device lock. */
 static struct cache_data slot[CACHE_SIZE];    /* Cache slot metadata. */
-static struct cache_block block[CACHE_SIZE];  /* Cache slot buffers. */
+static uint8_t *buffers;                      /* Cache slot buffers, each
+                                                 fs_block_size bytes. */
+static struct lock flush_lock;                /* Serializes cache_flush(). */
+static uint8_t *flush_buffers;                /* FLUSH_BATCH copies of slots
+                                                 being flushed. */
+static struct block_request flush_reqs[FLUSH_BATCH]; /* Their requests. */
+
+/* Returns the buffer for the given cache slot. */
+static inline uint8_t *
+slot_data (int slotid)
+{
+  return buffers + slotid * fs_block_size;
+}
 
 static struct lock ra_lock;                   /* Read-ahead queue lock. */
 static struct condition ra_cond;              /* Read-ahead condition variable
@@ -30,6 +44,9 @@ static struct condition ra_cond;              /* Read-ahead condition variable
 static int ra_queue[RA_QUEUE_SIZE];           /* Read-ahead queue. */
 static int ra_queue_counter = 0;              /* Read-ahead queue position. */
 
+static struct cache_stats stats;              /* Statistics, protected by
+                                                 cache_lock. */
+
 static void cache_done (int slotid, bool written);
 static int cache_get_slot (int sector);
 
@@ -39,6 +56,8 @@ static int cache_get_slot (int sector);
 static void
 cache_daemon_wb (void *aux UNUSED)
 {
+  /* Write-behind should not delay reads that threads are waiting for. */
+  block_set_io_class (BLOCK_IO_IDLE);
   while (true)
     {
       timer_msleep (WRITE_BEHIND_PERIOD);
@@ -78,6 +97,10 @@ cache_daemon_ra (void *aux UNUSED)
       int slotid = cache_get_slot (sector);
       cache_done (slotid, false);
       queue_pos++;
+
+      lock_acquire (&cache_lock);
+      stats.read_aheads++;
+      lock_release (&cache_lock);
     }
 }
 
@@ -85,19 +108,27 @@ void
 cache_init (void)
 {
   lock_init (&cache_lock);
-  lock_init (&io_lock);
+  lock_init (&flush_lock);
   lock_init (&ra_lock);
   cond_init (&ra_cond);
 
   /* Clear all of the cache metadata. By default, all cache slots will contain
      sector -1 (meaning no sector). */
   int i;
+  buffers = palloc_get_multiple (PAL_ASSERT,
+                                 DIV_ROUND_UP (CACHE_SIZE * fs_block_size,
+                                               PGSIZE));
+  flush_buffers = palloc_get_multiple (PAL_ASSERT,
+                                       DIV_ROUND_UP (FLUSH_BATCH
+                                                     * fs_block_size,
+                                                     PGSIZE));
   for (i = 0; i < CACHE_SIZE; ++i)
     {
       slot[i].sector = -1;
       slot[i].new_sector = -1;
       slot[i].dirty = false;
       slot[i].accesses = 0;
+      slot[i].flushing = false;
       lock_init (&slot[i].lock);
     }
 
@@ -121,25 +152,92 @@ cache_slot_flush (int slotid, int sector)
   ASSERT (sector >= 0);
   ASSERT (slot[slotid].dirty);
  
-  lock_acquire (&io_lock);
-  block_write (fs_device, sector, block[slotid].data);
-  lock_release (&io_lock);
+  block_write_multi (fs_device, sector * fs_block_sectors, fs_block_sectors,
+                     slot_data (slotid));
   
   slot[slotid].dirty = false;
 }
 
-/* Walks through the entire cache, flushing each slot in turn. */
+/* Completion function for the write requests in cache_flush(). */
+static void
+cache_flush_complete (struct block_request *r)
+{
+  struct cache_data *d = r->aux;
+  sema_up (&d->flushed);
+}
+
+/* Waits for cache_flush() to finish writing the given slot's old contents,
+   if it is doing so. Its sector on disk is stale until then, so this must
+   be done before the slot is written back or reused for another sector.
+   NOTE : Assumes that the caller has a lock on the slot. */
+static void
+cache_slot_wait (int slotid)
+{
+  ASSERT (lock_held_by_current_thread (&slot[slotid].lock));
+  if (slot[slotid].flushing)
+    {
+      /* Leave the semaphore up for cache_flush(), which also waits. */
+      sema_down (&slot[slotid].flushed);
+      sema_up (&slot[slotid].flushed);
+    }
+}
+
+/* Walks through the entire cache, flushing every dirty slot. Each dirty slot
+   is copied and marked clean, and its lock released, before the copy is
+   written, so that threads using the slot do not wait for the write. Up to
+   FLUSH_BATCH writes are submitted before waiting for any of them, so that
+   the block layer can sort them and merge adjacent ones. */
 void
 cache_flush (void)
 {
-  int i;
-  for (i = 0; i < CACHE_SIZE; ++i)
+  int batch[FLUSH_BATCH];
+  int i = 0, cnt, j;
+
+  lock_acquire (&flush_lock);
+  while (i < CACHE_SIZE)
     {
-      lock_acquire (&slot[i].lock);
-      if (slot[i].dirty)
-        cache_slot_flush (i, slot[i].sector);
-      lock_release (&slot[i].lock);
+      /* Copy and submit a batch of dirty slots. */
+      for (cnt = 0; i < CACHE_SIZE && cnt < FLUSH_BATCH; ++i)
+        {
+          lock_acquire (&slot[i].lock);
+          if (slot[i].dirty)
+            {
+              struct block_request *r = &flush_reqs[cnt];
+              uint8_t *copy = flush_buffers + cnt * fs_block_size;
+
+              memcpy (copy, slot_data (i), fs_block_size);
+              slot[i].dirty = false;
+              slot[i].flushing = true;
+              sema_init (&slot[i].flushed, 0);
+
+              r->write = true;
+              r->io_class = BLOCK_IO_AUTO;
+              r->sector = slot[i].sector * fs_block_sectors;
+              r->cnt = fs_block_sectors;
+              r->buffer = copy;
+              r->complete = cache_flush_complete;
+              r->aux = &slot[i];
+              block_submit (fs_device, r);
+              batch[cnt++] = i;
+            }
+          lock_release (&slot[i].lock);
+        }
+
+      /* Wait for the batch. */
+      for (j = 0; j < cnt; ++j)
+        {
+          struct cache_data *d = &slot[batch[j]];
+
+          /* Leave the semaphore up for cache_slot_wait(), which may
+             be waiting with the slot's lock held. */
+          sema_down (&d->flushed);
+          sema_up (&d->flushed);
+          lock_acquire (&d->lock);
+          d->flushing = false;
+          lock_release (&d->lock);
+        }
     }
+  lock_release (&flush_lock);
 }
 
 /* Forces the given cache slot to load sector data for the given sector from
@@ -152,9 +250,8 @@ cache_slot_load (int slotid, int sector)
   ASSERT (slotid >= 0 && slotid < CACHE_SIZE);
   ASSERT (sector >= 0);
   
-  lock_acquire (&io_lock);
-  block_read (fs_device, sector, block[slotid].data);
-  lock_release (&io_lock);
+  block_read_multi (fs_device, sector * fs_block_sectors, fs_block_sectors,
+                    slot_data (slotid));
 }
 
 /* Allocates a new buffer cache slot for the given sector, performing an
@@ -185,6 +282,8 @@ cache_alloc (int new_sector)
        release the cache_lock. */
     evict = clock;
   }
+  if (slot[evict].sector >= 0)
+    stats.evictions++;
 
   /* Once we mark the slot as in the process of eviction, we are free to
      release the cache lock, since no other thread will try to evict this
@@ -195,7 +294,9 @@ cache_alloc (int new_sector)
   /* Now, we need to acquire a lock on the slot we wish to evict. */
   lock_acquire (&slot[evict].lock);
 
-  /* If it's dirty, we'll need to flush the slot to disk. */
+  /* If it's dirty, we'll need to flush the slot to disk, after any older
+     copy that cache_flush() is writing. */
+  cache_slot_wait (evict);
   if (slot[evict].dirty)
     cache_slot_flush (evict, slot[evict].sector);
 
@@ -232,6 +333,7 @@ cache_get_slot (int sector)
          have to allocate a new one. */
       if (slotid < 0)
         {
+          stats.misses++;
           slotid = cache_alloc (sector);
           ASSERT (slotid >= 0 && slotid < CACHE_SIZE);
           ASSERT (lock_held_by_current_thread (&slot[slotid].lock));
@@ -240,6 +342,7 @@ cache_get_slot (int sector)
       /* Otherwise, we can just acquire a lock on the existing one. */
       else
         {
+          stats.hits++;
           lock_release (&cache_lock);
           ASSERT (slotid >= 0 && slotid < CACHE_SIZE);
           lock_acquire (&slot[slotid].lock);
@@ -275,7 +378,7 @@ void
 cache_ra_request (block_sector_t sector)
 {
   /* Make sure this request isn't beyond the maximal sector. */
-  if (sector >= block_size (fs_device)) return;
+  if (sector >= fs_block_cnt) return;
 
   lock_acquire (&ra_lock);
 
@@ -288,12 +391,23 @@ cache_ra_request (block_sector_t sector)
   lock_release (&ra_lock);
 }
 
+/* Stores a copy of the buffer cache statistics into *S.  A lookup
+   that races with an eviction and has to retry may be counted
+   twice. */
+void
+cache_get_stats (struct cache_stats *s)
+{
+  lock_acquire (&cache_lock);
+  *s = stats;
+  lock_release (&cache_lock);
+}
+
 /* Reads the given sector from the buffer cache. */
 void
 cache_read (block_sector_t sector, void *buffer, off_t off, unsigned size)
 {
   int slotid = cache_get_slot (sector);
-  memcpy (buffer, block[slotid].data + off, size);
+  memcpy (buffer, slot_data (slotid) + off, size);
   cache_done (slotid, false);
 }
 
@@ -302,7 +416,7 @@ void
 cache_write (block_sector_t sector, const void *data, off_t off, unsigned size)
 {
   int slotid = cache_get_slot (sector);
-  memcpy (block[slotid].data + off, data, size);
+  memcpy (slot_data (slotid) + off, data, size);
   cache_done (slotid, true);
 }
 
@@ -311,6 +425,6 @@ void
 cache_zero (block_sector_t sector)
 {
   int slotid = cache_get_slot (sector);
-  memset (block[slotid].data, 0, BLOCK_SECTOR_SIZE);
+  memset (slot_data (slotid), 0, fs_block_size);
   cache_done (slotid, true);
 }
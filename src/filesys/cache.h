@@ -1,13 +1,19 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
 #include "devices/block.h"
 #include <stdbool.h>
 #include <string.h>
 #include <random.h>
+#include <round.h>
 #include <debug.h>
 #include "devices/timer.h"
 #include "filesys/filesys.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
-/* Number of disk blocks stored in the buffer cache. */
+#include "threads/vaddr.h"
+/* Number of file system blocks stored in the buffer cache. */
 #define CACHE_SIZE 64
 
 /* Number of milliseconds to wait before flushing all cached data to disk. */
@@ -25,6 +31,16 @@
    efficient. On the other hand, raising the number too high could make
    eviction take a lot of CPU time. */
 #define MAX_ACCESS          5
+
+/* Buffer cache statistics. */
+struct cache_stats
+  {
+    unsigned long long hits;        /* Lookups that found the block. */
+    unsigned long long misses;      /* Lookups that had to load it. */
+    unsigned long long evictions;   /* Blocks evicted to make room. */
+    unsigned long long read_aheads; /* Read-ahead requests serviced. */
+  };
+
 void cache_init (void);
 void cache_read (block_sector_t sector, void *buffer, off_t off, unsigned size);
 void cache_write (block_sector_t sector, const void *data,
@@ -32,3 +48,6 @@ void cache_write (block_sector_t sector, const void *data,
 void cache_zero (block_sector_t sector);
 void cache_flush (void);
 void cache_ra_request (block_sector_t sector);
+void cache_get_stats (struct cache_stats *);
+
+#endif /* filesys/cache.h */
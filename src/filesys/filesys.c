@@ -3,17 +3,74 @@
 /* Partition that contains the file system. */
 struct block *fs_device = NULL;
 
+/* Block geometry, from the superblock. */
+size_t fs_block_size;
+size_t fs_block_sectors;
+block_sector_t fs_block_cnt;
+
+/* Identifies a superblock. */
+#define SUPER_MAGIC 0x53555052
+
+/* On-disk superblock.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct superblock
+  {
+    uint32_t magic;                     /* SUPER_MAGIC. */
+    uint32_t block_size;                /* Bytes per block. */
+    uint32_t block_cnt;                 /* Number of blocks. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 12]; /* Zero. */
+  };
+
 static void do_format (void);
 
+/* Sets the block geometry for SIZE-byte blocks.  Panics if SIZE
+   is not valid. */
+static void
+set_block_size (size_t size)
+{
+  if (size < FS_BLOCK_MIN || size > FS_BLOCK_MAX || (size & (size - 1)) != 0)
+    PANIC ("bad file system block size %zu", size);
+  fs_block_size = size;
+  fs_block_sectors = size / BLOCK_SECTOR_SIZE;
+  fs_block_cnt = block_size (fs_device) / fs_block_sectors;
+}
+
 /* Initializes the file system module.
-   If FORMAT is true, reformats the file system. */
+   If FORMAT is true, reformats the file system with SIZE-byte
+   blocks; otherwise, reads the block size from the superblock. */
 void
-filesys_init (bool format) 
+filesys_init (bool format, size_t size) 
 {
+  struct superblock sb;
+
+  ASSERT (sizeof sb == BLOCK_SECTOR_SIZE);
+
   fs_device = block_get_role (BLOCK_FILESYS);
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  if (format) 
+    {
+      set_block_size (size);
+      memset (&sb, 0, sizeof sb);
+      sb.magic = SUPER_MAGIC;
+      sb.block_size = fs_block_size;
+      sb.block_cnt = fs_block_cnt;
+      block_write (fs_device, SUPER_BLOCK, &sb);
+    }
+  else 
+    {
+      block_read (fs_device, SUPER_BLOCK, &sb);
+      if (sb.magic != SUPER_MAGIC)
+        PANIC ("%s: no file system found (use -f to format)",
+               block_name (fs_device));
+      set_block_size (sb.block_size);
+      if (sb.block_cnt != fs_block_cnt)
+        PANIC ("%s: file system is %"PRDSNu" blocks, device is %"PRDSNu,
+               block_name (fs_device), sb.block_cnt, fs_block_cnt);
+    }
+
+  cache_init ();
   inode_init ();
   free_map_init ();
 
@@ -166,10 +223,18 @@ filesys_create_dir (const char *name)
 static int
 filesys_lookup_recursive (const char *path, block_sector_t sector)
 {
+  size_t mark = scratch_mark ();
   size_t len = strlen (path);
-  char buf [len + 1];
-  char *cpath = buf;
-  strlcpy (buf, path, len + 1);
+  int result = -1;
+
+  /* Copy the path so that we can modify it, and make room for its longest
+     possible component.  Both live in scratch memory rather than on the
+     stack, since the path may be long. */
+  char *cpath = scratch_alloc (len + 1);
+  char *lookup_buf = scratch_alloc (len + 1);
+  if (cpath == NULL || lookup_buf == NULL)
+    goto done;
+  strlcpy (cpath, path, len + 1);
 
   while (true)
     {
@@ -177,7 +242,11 @@ filesys_lookup_recursive (const char *path, block_sector_t sector)
 
       /* If the length of the path is zero, it means that we've found what we
          were looking for! */
-      if (len == 0) return sector;
+      if (len == 0)
+        {
+          result = sector;
+          break;
+        }
 
       /* Chop off leading forward slashes. */
       if (cpath[0] == '/')
@@ -195,7 +264,6 @@ filesys_lookup_recursive (const char *path, block_sector_t sector)
 
       /* Determine the first component of the path. */
       size_t next_slash = strcspn (cpath, "/");
-      char lookup_buf [next_slash + 1];
       strlcpy (lookup_buf, cpath, next_slash + 1);
       
       /* Open the parent directory and look for the component. */
@@ -205,7 +273,7 @@ filesys_lookup_recursive (const char *path, block_sector_t sector)
       if (!file_is_dir (dir))
         {
           file_close (dir);
-          return -1;
+          break;
         }
 
       /* Search for the component in the parent directory. */
@@ -219,7 +287,7 @@ filesys_lookup_recursive (const char *path, block_sector_t sector)
          modifying the sector to reflect the new sector that we just found. */
 
       if (next_sector < 0)
-        return -1;
+        break;
       else
         {
           cpath += next_slash;
@@ -227,6 +295,10 @@ filesys_lookup_recursive (const char *path, block_sector_t sector)
           continue;
         }
     }
+
+ done:
+  scratch_release (mark);
+  return result;
 }
 
 /* Looks up NAME in the file system, returning the disk sector associated with
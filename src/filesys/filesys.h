@@ -12,14 +12,29 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "threads/thread.h"
-/* Sectors of system file inodes. */
-#define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
-#define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+/* The file system allocates, maps and caches space in blocks of
+   fs_block_size bytes, a power of two between FS_BLOCK_MIN and
+   FS_BLOCK_MAX chosen when the file system is formatted and
+   recorded in its superblock.  Block B occupies sectors
+   B * fs_block_sectors through (B + 1) * fs_block_sectors - 1
+   of the file system device.  Inode "sectors" elsewhere in the
+   file system are block numbers. */
+#define FS_BLOCK_MIN BLOCK_SECTOR_SIZE
+#define FS_BLOCK_MAX 4096
+
+/* Blocks of the superblock and system file inodes. */
+#define SUPER_BLOCK 0           /* Superblock, in block's first sector. */
+#define FREE_MAP_SECTOR 1       /* Free map file inode block. */
+#define ROOT_DIR_SECTOR 2       /* Root directory file inode block. */
 
 /* Block device that contains the file system. */
 struct block *fs_device;
 
-void filesys_init (bool format);
+extern size_t fs_block_size;            /* Bytes per block. */
+extern size_t fs_block_sectors;         /* Sectors per block. */
+extern block_sector_t fs_block_cnt;     /* Number of blocks. */
+
+void filesys_init (bool format, size_t size);
 bool filesys_initialized (void);
 void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size);
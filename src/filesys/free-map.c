@@ -2,24 +2,25 @@
 
 static struct file *free_map_file;   /* Free map file. */
 static struct lock free_map_lock;    /* Free map lock. */
-static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct bitmap *free_map;      /* Free map, one bit per block. */
 
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
-  free_map = bitmap_create (block_size (fs_device));
+  free_map = bitmap_create (fs_block_cnt);
   lock_init (&free_map_lock);
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
+  bitmap_mark (free_map, SUPER_BLOCK);
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
 }
 
-/* Allocates CNT consecutive sectors from the free map and stores
+/* Allocates CNT consecutive blocks from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
+   blocks were available or if the free_map file could not be
    written. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
@@ -41,7 +42,7 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT blocks starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
@@ -3,10 +3,18 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
-/* Various counts for keeping track of multi-level block indices in inodes. */
-#define INODE_L0_BLOCKS     ((BLOCK_SECTOR_SIZE / sizeof (uint32_t)) - 6)
-#define INODE_L1_BLOCKS     (BLOCK_SECTOR_SIZE / sizeof (uint32_t))
-#define INODE_L1_END        (INODE_L0_BLOCKS + INODE_L1_BLOCKS)
+/* Various counts for keeping track of multi-level block indices in inodes.
+   The direct blocks fill out the inode's whole file system block: the first
+   INODE_L0_BLOCKS are in struct inode_disk, in the block's first sector, and
+   the rest follow it in the same block.  Indirect blocks are whole file
+   system blocks. */
+#define INODE_META_WORDS    6
+#define INODE_L0_BLOCKS     ((BLOCK_SECTOR_SIZE / sizeof (uint32_t)) \
+                             - INODE_META_WORDS)
+#define INODE_DIRECT_BLOCKS ((fs_block_size / sizeof (uint32_t)) \
+                             - INODE_META_WORDS)
+#define INODE_L1_BLOCKS     (fs_block_size / sizeof (uint32_t))
+#define INODE_L1_END        (INODE_DIRECT_BLOCKS + INODE_L1_BLOCKS)
 #define INODE_L2_BLOCKS     (INODE_L1_BLOCKS * INODE_L1_BLOCKS)
 #define INODE_L2_END        (INODE_L1_END + INODE_L2_BLOCKS)
 
@@ -14,7 +22,7 @@
 struct inode
   {
     struct list_elem elem;              /* Element in inode list. */
-    block_sector_t sector;              /* Sector number of disk location. */
+    block_sector_t sector;              /* Block number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
@@ -22,16 +30,20 @@ struct inode
   };
 
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.  Occupies the start
+   of its own file system block.  With blocks bigger than a sector,
+   direct block I for I >= INODE_L0_BLOCKS is the 32-bit word at
+   index INODE_META_WORDS + I of that block, just as if l0[] ran on
+   to the end of the block. */
 struct inode_disk
   {
     off_t length;                           /* File size in bytes. */
     unsigned magic;                         /* Magic number. */
     uint32_t blocks;                        /* Number of allocated blocks. */
     uint32_t status;                        /* Status bits. */
-    uint32_t l2;                            /* Sector of doubly indirect block. */
-    uint32_t l1;                            /* Sector of indirect block. */
-    uint32_t l0[INODE_L0_BLOCKS];           /* Direct block sectors. */
+    uint32_t l2;                            /* Doubly indirect block. */
+    uint32_t l1;                            /* Indirect block. */
+    uint32_t l0[INODE_L0_BLOCKS];           /* Direct blocks. */
   };
 
 /* Top part of the on-disk inode, only includes metadata (no block sectors).
@@ -46,41 +58,48 @@ struct inode_disk_meta
     uint32_t status;                        /* Status bits. */
   };
 
-/* On-disk indirect or doubly-indirect block full of indices. */
-struct inode_disk_indirect
-  {
-    uint32_t block[INODE_L1_BLOCKS];
-  };
-
-/* Returns the number of sectors to allocate for an inode SIZE
+/* Returns the number of blocks to allocate for an inode SIZE
    bytes long. */
 static inline size_t
-bytes_to_sectors (off_t size)
+bytes_to_blocks (off_t size)
 {
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+  return DIV_ROUND_UP (size, fs_block_size);
 }
 
-/* Return the element at offset "index" in the indirect block whose sector is
-   given. A sort of disk "dereference" operation, so to speak. */
+/* Return the element at offset "index" in the indirect block whose number is
+   given. A sort of disk "dereference" operation, so to speak. Indirect blocks
+   are too large to copy onto the stack, so only the one element is read. */
 static int
 indirect_lookup (block_sector_t sector, off_t offset)
 {
-  struct inode_disk_indirect ind;
-  cache_read (sector, &ind, 0, BLOCK_SECTOR_SIZE);
-  return ind.block[offset];
+  uint32_t entry;
+  cache_read (sector, &entry, offset * sizeof entry, sizeof entry);
+  return entry;
 }
 
-/* Convert the given block number of the given inode into a disk sector, taking
-   into account the multi-level block hierarchy. */
+/* Stores VALUE as the element at offset "index" in the given indirect
+   block. */
+static void
+indirect_store (block_sector_t sector, off_t offset, uint32_t value)
+{
+  cache_write (sector, &value, offset * sizeof value, sizeof value);
+}
+
+/* Convert the given file block number of the given inode, whose on-disk
+   inode is in file system block SECTOR, into a file system block number,
+   taking into account the multi-level block hierarchy. */
 static int
-block_to_sector (const struct inode_disk *inode, unsigned block)
+block_to_sector (block_sector_t sector, const struct inode_disk *inode,
+                 unsigned block)
 {
   ASSERT (block < INODE_L2_END);
   
   if (block < INODE_L0_BLOCKS)
     return inode->l0[block];
+  else if (block < INODE_DIRECT_BLOCKS)
+    return indirect_lookup (sector, INODE_META_WORDS + block);
   else if (block < INODE_L1_END)
-    return indirect_lookup (inode->l1, block - INODE_L0_BLOCKS);
+    return indirect_lookup (inode->l1, block - INODE_DIRECT_BLOCKS);
   else
     {
       int l2_block =  (block - INODE_L1_END) / INODE_L1_BLOCKS;
@@ -89,7 +108,7 @@ block_to_sector (const struct inode_disk *inode, unsigned block)
     }
 }
 
-/* Returns the block device sector that contains byte offset POS
+/* Returns the file system block that contains byte offset POS
    within INODE. */
 static block_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) 
@@ -98,8 +117,8 @@ byte_to_sector (const struct inode *inode, off_t pos)
   
   struct inode_disk in;
   cache_read(inode->sector, &in, 0, BLOCK_SECTOR_SIZE);
-  ASSERT (pos < (off_t)(in.blocks * BLOCK_SECTOR_SIZE));
-  return block_to_sector (&in, pos / BLOCK_SECTOR_SIZE);
+  ASSERT (pos < (off_t)(in.blocks * fs_block_size));
+  return block_to_sector (inode->sector, &in, pos / fs_block_size);
 }
 
 /* List of open inodes, so that opening a single inode twice
@@ -114,11 +133,13 @@ void
 inode_init (void)
 {
   ASSERT (sizeof (struct inode_disk) == BLOCK_SECTOR_SIZE);
+  ASSERT (offsetof (struct inode_disk, l0)
+          == INODE_META_WORDS * sizeof (uint32_t));
   list_init (&open_inodes);
   lock_init (&open_inodes_lock);
 }
 
-/* Allocate a new block, zero the contents, and return the sector number. */
+/* Allocate a new block, zero the contents, and return the block number. */
 static int
 allocate_zeroed_block (void)
 {
@@ -147,19 +168,20 @@ inode_unlock (struct inode *inode)
   lock_release (&inode->lock);
 }
 
-/* Allocate and append a single block to the given inode. The inode will be
-   updated appropriately to support the new block, which may involve adding
-   an indirect or doubly-indirect block in addition to the new data block. */
+/* Allocate and append a single block to the given inode, whose on-disk
+   inode is in file system block SECTOR. The inode will be updated
+   appropriately to support the new block, which may involve adding an
+   indirect or doubly-indirect block in addition to the new data block. */
 static bool
-inode_extend_block (struct inode_disk *inode)
+inode_extend_block (block_sector_t sector, struct inode_disk *inode)
 {
   uint32_t blocks = inode->blocks;
   ASSERT (blocks < INODE_L2_END);
   int new_sector;
 
-  /* If we've reached the maximum number of L0 blocks, then we'll need to
+  /* If we've reached the maximum number of direct blocks, then we'll need to
      allocate an extra block for the indirect (L1) block. */
-  if (blocks == INODE_L0_BLOCKS)
+  if (blocks == INODE_DIRECT_BLOCKS)
     {
       if ((new_sector = allocate_zeroed_block ()) < 0) return false;
       inode->l1 = new_sector;
@@ -177,20 +199,20 @@ inode_extend_block (struct inode_disk *inode)
       if ((new_sector = allocate_zeroed_block ()) < 0) return false;
       inode->l0[blocks] = new_sector;
     }
+  else if (blocks < INODE_DIRECT_BLOCKS)
+    {
+      if ((new_sector = allocate_zeroed_block ()) < 0) return false;
+      indirect_store (sector, INODE_META_WORDS + blocks, new_sector);
+    }
   else if (blocks < INODE_L1_END)
     {
-      struct inode_disk_indirect ind;
-      cache_read (inode->l1, &ind, 0, BLOCK_SECTOR_SIZE);
       if ((new_sector = allocate_zeroed_block ()) < 0) return false;
-      ind.block[blocks - INODE_L0_BLOCKS] = new_sector;
-      cache_write (inode->l1, &ind, 0, BLOCK_SECTOR_SIZE); 
+      indirect_store (inode->l1, blocks - INODE_DIRECT_BLOCKS, new_sector);
     }
   else
     {
       int index =  (blocks - INODE_L1_END) / INODE_L1_BLOCKS;
       int offset = (blocks - INODE_L1_END) % INODE_L1_BLOCKS;
-      struct inode_disk_indirect ind;
-      cache_read (inode->l2, &ind, 0, BLOCK_SECTOR_SIZE);
       
       /* If this is the first block of a new L1 block, then we need to allocate
          the corresponding entry in the L2 block (since we haven't yet allocated
@@ -198,18 +220,13 @@ inode_extend_block (struct inode_disk *inode)
       if (offset == 0)
         {
           if ((new_sector = allocate_zeroed_block ()) < 0) return false;
-          ind.block[index] = new_sector;
-          cache_write (inode->l2, &ind, 0, BLOCK_SECTOR_SIZE);
+          indirect_store (inode->l2, index, new_sector);
         }
 
-      /* Now, fetch the L1 entry and create a new block in it. Note that we will
-         re-use the ind structure, since it is large and we don't want the
-         kernel stack to grow too large. */
-      int indirect_block = ind.block[index];
-      cache_read (indirect_block, &ind, 0, BLOCK_SECTOR_SIZE);
+      /* Now, fetch the L1 entry and create a new block in it. */
+      int indirect_block = indirect_lookup (inode->l2, index);
       if ((new_sector = allocate_zeroed_block ()) < 0) return false;
-      ind.block[offset] = new_sector;
-      cache_write (indirect_block, &ind, 0, BLOCK_SECTOR_SIZE);
+      indirect_store (indirect_block, offset, new_sector);
     }
 
   inode->blocks++;
@@ -229,9 +246,9 @@ inode_extend (struct inode *inode, unsigned size)
 
   int original_length = in.length;
   in.length += size;
-  while ((off_t)(in.blocks * BLOCK_SECTOR_SIZE) < in.length)
+  while ((off_t)(in.blocks * fs_block_size) < in.length)
     {
-      if (!inode_extend_block (&in))
+      if (!inode_extend_block (inode->sector, &in))
         return false;
     }
 
@@ -244,7 +261,7 @@ inode_extend (struct inode *inode, unsigned size)
 }
 
 /* Initializes an inode with LENGTH bytes of data and
-   writes the new inode to sector SECTOR on the file system
+   writes the new inode to block SECTOR on the file system
    device.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
@@ -253,6 +270,7 @@ bool
 inode_create (block_sector_t sector, off_t length, uint32_t status)
 {
   struct inode_disk *disk_inode = NULL;
+  size_t mark = scratch_mark ();
   bool success = false;
 
   ASSERT (length >= 0);
@@ -261,10 +279,10 @@ inode_create (block_sector_t sector, off_t length, uint32_t status)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
-  disk_inode = calloc (1, sizeof *disk_inode);
+  disk_inode = scratch_zalloc (sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
+      size_t sectors = bytes_to_blocks (length);
       disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
       disk_inode->status = status;
@@ -273,7 +291,7 @@ inode_create (block_sector_t sector, off_t length, uint32_t status)
 	      {
 	        size_t i;
 	        for (i = 0; i < sectors; i++)
-            if (!inode_extend_block (disk_inode))
+            if (!inode_extend_block (sector, disk_inode))
               {
                 success = false;
                 break;
@@ -281,11 +299,11 @@ inode_create (block_sector_t sector, off_t length, uint32_t status)
 	      }
 	    cache_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
     }
-  free (disk_inode);
+  scratch_release (mark);
   return success;
 }
 
-/* Reads an inode from SECTOR
+/* Reads an inode from block SECTOR
    and returns a `struct inode' that contains it.
    Returns a null pointer if memory allocation fails. */
 struct inode *
@@ -375,7 +393,7 @@ inode_close (struct inode *inode)
           cache_read (inode->sector, &in, 0, BLOCK_SECTOR_SIZE);
           size_t i;
           for (i = 0; i < in.blocks; ++i)
-            free_map_release (block_to_sector (&in, i), 1);
+            free_map_release (block_to_sector (inode->sector, &in, i), 1);
           free_map_release (inode->sector, 1);
         }
 
@@ -414,16 +432,16 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
   while (size > 0) 
     {
-      /* Disk sector to read, starting byte offset within sector. */
+      /* Block to read, starting byte offset within block. */
       block_sector_t sector_idx = byte_to_sector (inode, offset);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      int sector_ofs = offset % fs_block_size;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
+      /* Bytes left in inode, bytes left in block, lesser of the two. */
       off_t inode_left = inode_len - offset;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+      int sector_left = fs_block_size - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
-      /* Number of bytes to actually copy out of this sector. */
+      /* Number of bytes to actually copy out of this block. */
       int chunk_size = size < min_left ? size : min_left;
 
       if (chunk_size <= 0)
@@ -438,8 +456,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
   /* If there's still another block left in this file, issue a cache
      read-ahead request for it, in anticipation of the next read. */
-  if (inode_length (inode) > offset + BLOCK_SECTOR_SIZE)
-    cache_ra_request (byte_to_sector (inode, offset + BLOCK_SECTOR_SIZE));
+  if (inode_length (inode) > (off_t) (offset + fs_block_size))
+    cache_ra_request (byte_to_sector (inode, offset + fs_block_size));
 
   return bytes_read;
 }
@@ -496,12 +514,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
   while (size > 0) 
     {
-      /* Sector to write, starting byte offset within sector. */
+      /* Block to write, starting byte offset within block. */
       block_sector_t sector_idx = byte_to_sector (inode, offset);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+      int sector_ofs = offset % fs_block_size;
+      int sector_left = fs_block_size - sector_ofs;
       
-      /* Number of bytes to actually write into this sector. */
+      /* Number of bytes to actually write into this block. */
       int chunk_size = size < sector_left ? size : sector_left;
       if (chunk_size <= 0)
         break;
@@ -520,14 +538,13 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
      we change the inode's length). */
   if (grow_size > 0)
     {
-      /* Note that we use dynamic memory here to prevent a kernel stack
-         overflow. */
-      struct inode_disk *in = malloc (sizeof (struct inode_disk));
-      cache_read (inode->sector, in, 0, BLOCK_SECTOR_SIZE);
-      in->length += grow_size;
-      cache_write (inode->sector, in, 0, BLOCK_SECTOR_SIZE);
+      /* Only the metadata changes, so there is no need to copy the
+         whole on-disk inode, and nothing here can fail. */
+      struct inode_disk_meta in;
+      cache_read (inode->sector, &in, 0, sizeof in);
+      in.length += grow_size;
+      cache_write (inode->sector, &in, 0, sizeof in);
       if (locked) inode_unlock (inode);
-      free (in);
     }
 
   return bytes_written;
@@ -601,7 +618,7 @@ inode_set_attribute (struct inode *inode, uint32_t attribute, bool on)
   cache_write(inode->sector, &in, 0, sizeof in);
 }
 
-/* Returns the sector of the inode. */
+/* Returns the block of the inode. */
 int 
 inode_get_inum (struct inode *inode)
 {
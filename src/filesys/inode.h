@@ -12,6 +12,7 @@
 #include "filesys/free-map.h"
 #include "filesys/cache.h"
 #include "threads/malloc.h"
+#include "threads/scratch.h"
 #include "threads/synch.h"
 
 /* Below are the status bits for an inode. */
@@ -1,6 +1,7 @@
 #include <console.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/serial.h"
 #include "devices/vga.h"
 #include "threads/init.h"
@@ -8,7 +9,24 @@
 #include "threads/synch.h"
 
 static void vprintf_helper (char, void *);
-static void putchar_have_lock (uint8_t c);
+static void write_have_lock (const char *, size_t);
+
+/* vprintf() formats its output into a buffer of this many bytes
+   on the stack and sends each bufferful to the devices at once,
+   instead of one character at a time.  The buffer cannot be
+   static: interrupt handlers and a panicking kernel print
+   without the console lock, and a printf() nested inside another
+   (see console_lock_depth) would overwrite the outer one's
+   output.  Kernel stacks are small, so keep it short. */
+#define VPRINTF_BUF_SIZE 32
+
+/* Output buffer for vprintf(). */
+struct vprintf_buffer
+  {
+    char buf[VPRINTF_BUF_SIZE]; /* Formatted output not yet written. */
+    size_t len;                 /* Number of bytes in BUF. */
+    int char_cnt;               /* Total characters formatted. */
+  };
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -44,8 +62,8 @@ static bool use_console_lock;
    thread_yield()
    intr_handler()         - timer interrupt
    intr_set_level()
-   serial_putc()
-   putchar_have_lock()
+   serial_write()
+   write_have_lock()
    putbuf()
    sys_write()            - one process writing to the console
    syscall_handler()
@@ -125,13 +143,16 @@ console_locked_by_current_thread (void)
 int
 vprintf (const char *format, va_list args) 
 {
-  int char_cnt = 0;
+  struct vprintf_buffer b;
 
+  b.len = 0;
+  b.char_cnt = 0;
   acquire_console ();
-  __vprintf (format, args, vprintf_helper, &char_cnt);
+  __vprintf (format, args, vprintf_helper, &b);
+  write_have_lock (b.buf, b.len);
   release_console ();
 
-  return char_cnt;
+  return b.char_cnt;
 }
 
 /* Writes string S to the console, followed by a new-line
@@ -140,9 +161,8 @@ int
 puts (const char *s) 
 {
   acquire_console ();
-  while (*s != '\0')
-    putchar_have_lock (*s++);
-  putchar_have_lock ('\n');
+  write_have_lock (s, strlen (s));
+  write_have_lock ("\n", 1);
   release_console ();
 
   return 0;
@@ -153,8 +173,7 @@ void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  write_have_lock (buffer, n);
   release_console ();
 }
 
@@ -162,8 +181,10 @@ putbuf (const char *buffer, size_t n)
 int
 putchar (int c) 
 {
+  char ch = c;
+
   acquire_console ();
-  putchar_have_lock (c);
+  write_have_lock (&ch, 1);
   release_console ();
   
   return c;
@@ -171,21 +192,29 @@ putchar (int c)
 
 /* Helper function for vprintf(). */
 static void
-vprintf_helper (char c, void *char_cnt_) 
+vprintf_helper (char c, void *b_) 
 {
-  int *char_cnt = char_cnt_;
-  (*char_cnt)++;
-  putchar_have_lock (c);
+  struct vprintf_buffer *b = b_;
+
+  b->char_cnt++;
+  if (b->len >= sizeof b->buf) 
+    {
+      write_have_lock (b->buf, b->len);
+      b->len = 0;
+    }
+  b->buf[b->len++] = c;
 }
 
-/* Writes C to the vga display and serial port.
-   The caller has already acquired the console lock if
-   appropriate. */
+/* Writes the N characters in BUFFER to the vga display and
+   serial port.  The caller has already acquired the console
+   lock if appropriate. */
 static void
-putchar_have_lock (uint8_t c) 
+write_have_lock (const char *buffer, size_t n) 
 {
   ASSERT (console_locked_by_current_thread ());
-  write_cnt++;
-  serial_putc (c);
-  vga_putc (c);
+  if (n == 0)
+    return;
+  write_cnt += n;
+  serial_write ((const uint8_t *) buffer, n);
+  vga_write (buffer, n);
 }
@@ -0,0 +1,416 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Smallest number of slots in a table. */
+#define MIN_SLOTS 8
+
+/* Returned by find_slot() when no slot matches. */
+#define NO_SLOT SIZE_MAX
+
+static size_t probe_distance (const struct ohash *, unsigned hash,
+                              size_t slot);
+static size_t find_slot (struct ohash *, const struct ohash_elem *,
+                         unsigned hash);
+static void place_elem (struct ohash *, struct ohash_elem *);
+static void insert_elem (struct ohash *, struct ohash_elem *);
+static void remove_slot (struct ohash *, size_t slot);
+static bool resize (struct ohash *, size_t slot_cnt);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using EQUAL, given auxiliary data AUX.
+   Returns true if successful, false on allocation failure. */
+bool
+ohash_init (struct ohash *h,
+            ohash_hash_func *hash, ohash_equal_func *equal, void *aux)
+{
+  h->elem_cnt = 0;
+  h->slot_cnt = MIN_SLOTS;
+  h->slots = malloc (sizeof *h->slots * h->slot_cnt);
+  h->hash = hash;
+  h->equal = equal;
+  h->aux = aux;
+
+  if (h->slots != NULL)
+    {
+      ohash_clear (h, NULL);
+      return true;
+    }
+  else
+    return false;
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while ohash_clear() is running, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), ohash_delete(), or ohash_remove(), yields
+   undefined behavior, whether done in DESTRUCTOR or elsewhere. */
+void
+ohash_clear (struct ohash *h, ohash_action_func *destructor)
+{
+  size_t i;
+
+  for (i = 0; i < h->slot_cnt; i++)
+    {
+      struct ohash_slot *s = &h->slots[i];
+
+      if (destructor != NULL && s->elem != NULL)
+        destructor (s->elem, h->aux);
+      s->elem = NULL;
+    }
+
+  h->elem_cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash, with the same restrictions as in
+   ohash_clear(). */
+void
+ohash_destroy (struct ohash *h, ohash_action_func *destructor)
+{
+  if (destructor != NULL)
+    ohash_clear (h, destructor);
+  free (h->slots);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW. */
+struct ohash_elem *
+ohash_insert (struct ohash *h, struct ohash_elem *new)
+{
+  unsigned hash = h->hash (new, h->aux);
+  size_t slot = find_slot (h, new, hash);
+
+  if (slot != NO_SLOT)
+    return h->slots[slot].elem;
+
+  new->hash = hash;
+  insert_elem (h, new);
+  return NULL;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned. */
+struct ohash_elem *
+ohash_replace (struct ohash *h, struct ohash_elem *new)
+{
+  unsigned hash = h->hash (new, h->aux);
+  size_t slot = find_slot (h, new, hash);
+
+  new->hash = hash;
+  if (slot != NO_SLOT)
+    {
+      /* The old element has the same hash value, so NEW can
+         simply take over its slot. */
+      struct ohash_elem *old = h->slots[slot].elem;
+      h->slots[slot].elem = new;
+      return old;
+    }
+
+  insert_elem (h, new);
+  return NULL;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct ohash_elem *
+ohash_find (struct ohash *h, const struct ohash_elem *e)
+{
+  size_t slot = find_slot (h, e, h->hash (e, h->aux));
+
+  return slot != NO_SLOT ? h->slots[slot].elem : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct ohash_elem *
+ohash_delete (struct ohash *h, const struct ohash_elem *e)
+{
+  size_t slot = find_slot (h, e, h->hash (e, h->aux));
+  struct ohash_elem *found;
+
+  if (slot == NO_SLOT)
+    return NULL;
+
+  found = h->slots[slot].elem;
+  remove_slot (h, slot);
+  return found;
+}
+
+/* Removes E, which must be in hash table H, from H.  Unlike
+   ohash_delete(), this neither hashes nor compares elements: it
+   uses the hash value cached in E when it was inserted to find
+   E's slot directly. */
+void
+ohash_remove (struct ohash *h, struct ohash_elem *e)
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t slot = e->hash & mask;
+
+  while (h->slots[slot].elem != e)
+    {
+      ASSERT (h->slots[slot].elem != NULL);
+      slot = (slot + 1) & mask;
+    }
+  remove_slot (h, slot);
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while ohash_apply() is running, using
+   any of the functions ohash_clear(), ohash_destroy(),
+   ohash_insert(), ohash_replace(), ohash_delete(), or
+   ohash_remove(), yields undefined behavior, whether done from
+   ACTION or elsewhere. */
+void
+ohash_apply (struct ohash *h, ohash_action_func *action)
+{
+  size_t i;
+
+  ASSERT (action != NULL);
+
+  for (i = 0; i < h->slot_cnt; i++)
+    if (h->slots[i].elem != NULL)
+      action (h->slots[i].elem, h->aux);
+}
+
+/* Initializes I for iterating hash table H.
+
+   Iteration idiom:
+
+      struct ohash_iterator i;
+
+      ohash_first (&i, h);
+      while (ohash_next (&i))
+        {
+          struct foo *f = ohash_entry (ohash_cur (&i), struct foo, elem);
+          ...do something with f...
+        }
+
+   Modifying hash table H during iteration, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), ohash_delete(), or ohash_remove(),
+   invalidates all iterators. */
+void
+ohash_first (struct ohash_iterator *i, struct ohash *h)
+{
+  ASSERT (i != NULL);
+  ASSERT (h != NULL);
+
+  i->hash = h;
+  i->slot = 0;
+  i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct ohash_elem *
+ohash_next (struct ohash_iterator *i)
+{
+  ASSERT (i != NULL);
+
+  i->elem = NULL;
+  while (i->slot < i->hash->slot_cnt)
+    {
+      i->elem = i->hash->slots[i->slot++].elem;
+      if (i->elem != NULL)
+        break;
+    }
+
+  return i->elem;
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling ohash_first() but before ohash_next(). */
+struct ohash_elem *
+ohash_cur (struct ohash_iterator *i)
+{
+  return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (struct ohash *h)
+{
+  return h->elem_cnt == 0;
+}
+
+/* Returns how far SLOT is from the home slot of an element with
+   the given HASH value, that is, the number of slots that were
+   probed before reaching SLOT. */
+static size_t
+probe_distance (const struct ohash *h, unsigned hash, size_t slot)
+{
+  return (slot - hash) & (h->slot_cnt - 1);
+}
+
+/* Searches H for an element equal to E, whose hash value is
+   HASH.  Returns its slot index if found, NO_SLOT otherwise.
+
+   The table always has at least one empty slot, so the search
+   terminates. */
+static size_t
+find_slot (struct ohash *h, const struct ohash_elem *e, unsigned hash)
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t slot = hash & mask;
+  size_t distance;
+
+  for (distance = 0; ; distance++, slot = (slot + 1) & mask)
+    {
+      const struct ohash_slot *s = &h->slots[slot];
+
+      /* Robin Hood insertion would have placed E no further from
+         home than any element it passed, so once we meet an
+         empty slot or an element closer to its home than we are
+         to ours, E cannot be in the table. */
+      if (s->elem == NULL || probe_distance (h, s->hash, slot) < distance)
+        return NO_SLOT;
+      if (s->hash == hash && h->equal (s->elem, e, h->aux))
+        return slot;
+    }
+}
+
+/* Places E, whose hash value is cached in E->hash and which is
+   not in the table, into H.  Does not update H->elem_cnt and
+   does not resize H. */
+static void
+place_elem (struct ohash *h, struct ohash_elem *e)
+{
+  size_t mask = h->slot_cnt - 1;
+  unsigned hash = e->hash;
+  size_t slot = hash & mask;
+  size_t distance = 0;
+
+  for (;;)
+    {
+      struct ohash_slot *s = &h->slots[slot];
+      size_t s_distance;
+
+      if (s->elem == NULL)
+        {
+          s->hash = hash;
+          s->elem = e;
+          return;
+        }
+
+      /* Take the slot from an element closer to home, then go
+         on to find a slot for that element. */
+      s_distance = probe_distance (h, s->hash, slot);
+      if (s_distance < distance)
+        {
+          struct ohash_elem *displaced = s->elem;
+          unsigned displaced_hash = s->hash;
+
+          s->hash = hash;
+          s->elem = e;
+          e = displaced;
+          hash = displaced_hash;
+          distance = s_distance;
+        }
+
+      slot = (slot + 1) & mask;
+      distance++;
+    }
+}
+
+/* Inserts E, which is not in the table, into H, first growing H
+   if it is becoming full. */
+static void
+insert_elem (struct ohash *h, struct ohash_elem *e)
+{
+  if ((h->elem_cnt + 1) * 8 > h->slot_cnt * 7
+      && !resize (h, h->slot_cnt * 2)
+      && h->elem_cnt + 1 >= h->slot_cnt)
+    {
+      /* Inserting would leave no empty slot, which searches
+         depend on.  Past 7/8 full, the table keeps working
+         without growing, just more slowly, but not this far. */
+      PANIC ("ohash: out of memory with %zu elements", h->elem_cnt);
+    }
+
+  place_elem (h, e);
+  h->elem_cnt++;
+}
+
+/* Empties SLOT in H, shifting the elements that follow it back
+   by one slot until reaching an empty slot or an element in its
+   home slot.  Then shrinks H if it has become sparse. */
+static void
+remove_slot (struct ohash *h, size_t slot)
+{
+  size_t mask = h->slot_cnt - 1;
+
+  for (;;)
+    {
+      size_t next = (slot + 1) & mask;
+      struct ohash_slot *s = &h->slots[next];
+
+      if (s->elem == NULL || probe_distance (h, s->hash, next) == 0)
+        break;
+      h->slots[slot] = *s;
+      slot = next;
+    }
+  h->slots[slot].elem = NULL;
+  h->elem_cnt--;
+
+  if (h->slot_cnt > MIN_SLOTS && h->elem_cnt * 8 < h->slot_cnt)
+    resize (h, h->slot_cnt / 2);
+}
+
+/* Changes the number of slots in H to SLOT_CNT, a power of 2,
+   moving every element to its slot in the new array.  Returns
+   true if successful.  On allocation failure, leaves H
+   unchanged and returns false. */
+static bool
+resize (struct ohash *h, size_t slot_cnt)
+{
+  struct ohash_slot *old_slots = h->slots;
+  size_t old_slot_cnt = h->slot_cnt;
+  struct ohash_slot *new_slots;
+  size_t i;
+
+  ASSERT (slot_cnt > h->elem_cnt);
+  ASSERT ((slot_cnt & (slot_cnt - 1)) == 0);
+
+  new_slots = malloc (sizeof *new_slots * slot_cnt);
+  if (new_slots == NULL)
+    return false;
+  for (i = 0; i < slot_cnt; i++)
+    new_slots[i].elem = NULL;
+
+  h->slots = new_slots;
+  h->slot_cnt = slot_cnt;
+  for (i = 0; i < old_slot_cnt; i++)
+    if (old_slots[i].elem != NULL)
+      place_elem (h, old_slots[i].elem);
+
+  free (old_slots);
+  return true;
+}
@@ -0,0 +1,116 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+
+   This is an alternative to the chained hash table in hash.h,
+   for indexes that are looked up on hot paths.  The table is a
+   single array of slots, each holding an element's full 32-bit
+   hash value next to a pointer to the element.  A lookup probes
+   consecutive slots and compares hash values, which share cache
+   lines, and only follows an element pointer when the hash
+   values match.  A chained table instead follows a list pointer
+   into a different element for every comparison.
+
+   Collisions are resolved by linear probing with "Robin Hood"
+   insertion: an element being inserted takes the slot of any
+   element that is closer to its own home slot, so that probe
+   sequences stay short and about equally long even at high load
+   factors.  A lookup can stop as soon as it meets an element
+   that is closer to home than the one it is looking for.
+   Deletion shifts the following elements back one slot, so
+   there are no tombstones.
+
+   Like hash.h, the table is intrusive and does no allocation
+   per element: each structure that can be in an ohash embeds a
+   struct ohash_elem member, and ohash_entry() converts from a
+   struct ohash_elem back to the structure that contains it.  Use
+   the sample hash functions in hash.h, such as hash_int(), to
+   hash keys.
+
+   Only the slot array itself is allocated, with malloc().  It
+   grows when the table becomes 7/8 full and shrinks when it
+   becomes less than 1/8 full. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open-addressing hash element. */
+struct ohash_elem
+  {
+    unsigned hash;              /* Hash value, cached by insertion. */
+  };
+
+/* Converts pointer to hash element OHASH_ELEM into a pointer to
+   the structure that OHASH_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the hash element. */
+#define ohash_entry(OHASH_ELEM, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) &(OHASH_ELEM)->hash            \
+                     - offsetof (STRUCT, MEMBER.hash)))
+
+/* Computes and returns the hash value for hash element E, given
+   auxiliary data AUX. */
+typedef unsigned ohash_hash_func (const struct ohash_elem *e, void *aux);
+
+/* Returns true if hash elements A and B have equal keys, given
+   auxiliary data AUX. */
+typedef bool ohash_equal_func (const struct ohash_elem *a,
+                               const struct ohash_elem *b,
+                               void *aux);
+
+/* Performs some operation on hash element E, given auxiliary
+   data AUX. */
+typedef void ohash_action_func (struct ohash_elem *e, void *aux);
+
+/* A slot in the table.  ELEM is a null pointer in empty slots. */
+struct ohash_slot
+  {
+    unsigned hash;              /* Hash value of ELEM. */
+    struct ohash_elem *elem;    /* Element, or null if empty. */
+  };
+
+/* Open-addressing hash table. */
+struct ohash
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+    ohash_hash_func *hash;      /* Hash function. */
+    ohash_equal_func *equal;    /* Equality function. */
+    void *aux;                  /* Auxiliary data for `hash' and `equal'. */
+  };
+
+/* An open-addressing hash table iterator. */
+struct ohash_iterator
+  {
+    struct ohash *hash;         /* The hash table. */
+    size_t slot;                /* Index of the next slot to examine. */
+    struct ohash_elem *elem;    /* Current hash element. */
+  };
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *, ohash_hash_func *, ohash_equal_func *,
+                 void *aux);
+void ohash_clear (struct ohash *, ohash_action_func *);
+void ohash_destroy (struct ohash *, ohash_action_func *);
+
+/* Search, insertion, deletion. */
+struct ohash_elem *ohash_insert (struct ohash *, struct ohash_elem *);
+struct ohash_elem *ohash_replace (struct ohash *, struct ohash_elem *);
+struct ohash_elem *ohash_find (struct ohash *, const struct ohash_elem *);
+struct ohash_elem *ohash_delete (struct ohash *, const struct ohash_elem *);
+void ohash_remove (struct ohash *, struct ohash_elem *);
+
+/* Iteration. */
+void ohash_apply (struct ohash *, ohash_action_func *);
+void ohash_first (struct ohash_iterator *, struct ohash *);
+struct ohash_elem *ohash_next (struct ohash_iterator *);
+struct ohash_elem *ohash_cur (struct ohash_iterator *);
+
+/* Information. */
+size_t ohash_size (struct ohash *);
+bool ohash_empty (struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
@@ -0,0 +1,209 @@
+#include "pheap.h"
+#include "../debug.h"
+
+/* Pairing heap.
+
+   See pheap.h for basic information.
+
+   A pairing heap is a tree in which every element is no greater
+   than its children.  Each element keeps its children in a
+   doubly linked list, so that any element can cut itself out of
+   its parent's list in O(1) time.
+
+   Inserting melds the new element with the root: the greater of
+   the two becomes the first child of the lesser.  Removing the
+   root leaves a list of subtrees, which are melded in two passes,
+   first in pairs from left to right and then the pairs from right
+   to left.  The two-pass scheme is what gives the O(log n)
+   amortized bound; see Fredman, Sedgewick, Sleator, and Tarjan,
+   "The pairing heap: a new form of self-adjusting heap",
+   Algorithmica 1(1), 1986. */
+
+static struct pheap_elem *meld (struct pheap *, struct pheap_elem *,
+                                struct pheap_elem *);
+static struct pheap_elem *merge_pairs (struct pheap *, struct pheap_elem *);
+static void cut (struct pheap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+pheap_init (struct pheap *heap, pheap_less_func *less, void *aux)
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->elem_cnt = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+pheap_insert (struct pheap *heap, struct pheap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->next = elem->prev = NULL;
+  heap->root = meld (heap, heap->root, elem);
+  heap->elem_cnt++;
+}
+
+/* Removes and returns the least element in HEAP, which must not
+   be empty. */
+struct pheap_elem *
+pheap_pop_min (struct pheap *heap)
+{
+  struct pheap_elem *min;
+
+  ASSERT (heap != NULL);
+  ASSERT (!pheap_empty (heap));
+
+  min = heap->root;
+  heap->root = merge_pairs (heap, min->child);
+  heap->elem_cnt--;
+  return min;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+pheap_remove (struct pheap *heap, struct pheap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root)
+    pheap_pop_min (heap);
+  else
+    {
+      cut (elem);
+      heap->root = meld (heap, heap->root,
+                         merge_pairs (heap, elem->child));
+      heap->elem_cnt--;
+    }
+}
+
+/* Restores HEAP's ordering after the key of ELEM, which must be
+   in HEAP, has been decreased.  (To increase an element's key,
+   remove it, change it, and insert it again.) */
+void
+pheap_decrease (struct pheap *heap, struct pheap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem != heap->root)
+    {
+      /* ELEM's subtree is still ordered, so it can be melded
+         with the rest of the heap as a whole. */
+      cut (elem);
+      heap->root = meld (heap, heap->root, elem);
+    }
+}
+
+/* Returns the least element in HEAP, or a null pointer if HEAP
+   is empty. */
+struct pheap_elem *
+pheap_min (struct pheap *heap)
+{
+  ASSERT (heap != NULL);
+  return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+pheap_size (struct pheap *heap)
+{
+  return heap->elem_cnt;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+pheap_empty (struct pheap *heap)
+{
+  return heap->root == NULL;
+}
+
+/* Melds the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings or parents. */
+static struct pheap_elem *
+meld (struct pheap *heap, struct pheap_elem *a, struct pheap_elem *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+
+  if (heap->less (b, a, heap->aux))
+    {
+      struct pheap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the first child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds FIRST and the siblings that follow it into a single tree
+   and returns its root, or a null pointer if FIRST is null. */
+static struct pheap_elem *
+merge_pairs (struct pheap *heap, struct pheap_elem *first)
+{
+  struct pheap_elem *pairs = NULL;
+  struct pheap_elem *root = NULL;
+
+  /* First pass: meld adjacent pairs from left to right, pushing
+     each result onto PAIRS, which is linked through `next'. */
+  while (first != NULL)
+    {
+      struct pheap_elem *a = first;
+      struct pheap_elem *b = a->next;
+      struct pheap_elem *pair;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        b->next = b->prev = NULL;
+
+      pair = meld (heap, a, b);
+      pair->next = pairs;
+      pairs = pair;
+    }
+
+  /* Second pass: meld the pairs from right to left, which is the
+     order they come off PAIRS. */
+  while (pairs != NULL)
+    {
+      struct pheap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = meld (heap, root, pairs);
+      pairs = next;
+    }
+
+  return root;
+}
+
+/* Cuts E, which must not be the root, and its subtree out of its
+   parent's list of children. */
+static void
+cut (struct pheap_elem *e)
+{
+  ASSERT (e->prev != NULL);
+
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
@@ -0,0 +1,109 @@
+#ifndef __LIB_KERNEL_PHEAP_H
+#define __LIB_KERNEL_PHEAP_H
+
+/* Pairing heap.
+
+   A pairing heap is a priority queue: it gives quick access to
+   its least element.  Insertion takes O(1) time and removal of
+   the least element, or of any other element, takes O(log n)
+   amortized time.  Use it instead of a list kept sorted with
+   list_insert_ordered(), or searched with list_min(), when only
+   the least element is ever needed, as in a queue of sleeping
+   threads ordered by wakeup time.
+
+   Like lists, pairing heaps do not use dynamically allocated
+   memory.  Each structure that is a potential heap element must
+   embed a struct pheap_elem member, and the pheap_entry macro
+   converts from a struct pheap_elem back to the structure that
+   contains it.  Refer to lib/kernel/list.h for a detailed
+   explanation.
+
+   For example, a queue of `struct foo' ordered by `when':
+
+      struct foo
+        {
+          struct pheap_elem elem;
+          int64_t when;
+          ...other members...
+        };
+
+      static bool
+      foo_less (const struct pheap_elem *a_,
+                const struct pheap_elem *b_, void *aux UNUSED)
+      {
+        const struct foo *a = pheap_entry (a_, struct foo, elem);
+        const struct foo *b = pheap_entry (b_, struct foo, elem);
+
+        return a->when < b->when;
+      }
+
+      struct pheap foo_heap;
+
+      pheap_init (&foo_heap, foo_less, NULL);
+      ...
+      while (!pheap_empty (&foo_heap)
+             && pheap_entry (pheap_min (&foo_heap),
+                             struct foo, elem)->when <= now)
+        {
+          struct foo *f = pheap_entry (pheap_pop_min (&foo_heap),
+                                       struct foo, elem);
+          ...do something with f...
+        }
+
+   Equal elements come out in no particular order.  An element's
+   key must not change while it is in a heap, except through
+   pheap_decrease(). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Pairing heap element. */
+struct pheap_elem
+  {
+    struct pheap_elem *child;   /* First child, or null. */
+    struct pheap_elem *next;    /* Next sibling, or null. */
+    struct pheap_elem *prev;    /* Previous sibling, or parent if this
+                                   is the first child, or null if this
+                                   is the root. */
+  };
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool pheap_less_func (const struct pheap_elem *a,
+                              const struct pheap_elem *b,
+                              void *aux);
+
+/* Pairing heap. */
+struct pheap
+  {
+    struct pheap_elem *root;    /* Least element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements. */
+    pheap_less_func *less;      /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Converts pointer to heap element PHEAP_ELEM into a pointer to
+   the structure that PHEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element.  See the big comment at the top of the
+   file for an example. */
+#define pheap_entry(PHEAP_ELEM, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) &(PHEAP_ELEM)->child           \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+void pheap_init (struct pheap *, pheap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void pheap_insert (struct pheap *, struct pheap_elem *);
+struct pheap_elem *pheap_pop_min (struct pheap *);
+void pheap_remove (struct pheap *, struct pheap_elem *);
+void pheap_decrease (struct pheap *, struct pheap_elem *);
+
+/* Heap properties. */
+struct pheap_elem *pheap_min (struct pheap *);
+size_t pheap_size (struct pheap *);
+bool pheap_empty (struct pheap *);
+
+#endif /* lib/kernel/pheap.h */
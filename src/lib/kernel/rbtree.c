@@ -0,0 +1,449 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree.
+
+   See rbtree.h for basic information.
+
+   The implementation follows Cormen, Leiserson, Rivest, and
+   Stein, _Introduction to Algorithms_, chapter 13, except that
+   null pointers stand in for the black leaves.  A tree satisfies
+   these properties, which keep every path from the root to a
+   leaf within a factor of 2 of every other:
+
+     1. The root is black.
+
+     2. A red element has no red children.
+
+     3. Every path from an element down to a leaf passes through
+        the same number of black elements. */
+
+static bool is_red (const struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *old,
+                           struct rb_elem *new);
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+static struct rb_elem *leftmost (struct rb_elem *);
+static struct rb_elem *rightmost (struct rb_elem *);
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->elem_cnt = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts ELEM into TREE, after any elements equal to it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_elem *elem)
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &tree->root;
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      link = (tree->less (elem, parent, tree->aux)
+              ? &parent->left : &parent->right);
+    }
+
+  elem->parent = parent;
+  elem->left = elem->right = NULL;
+  elem->red = true;
+  *link = elem;
+  tree->elem_cnt++;
+
+  insert_fixup (tree, elem);
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_elem *elem)
+{
+  struct rb_elem *child, *parent;
+  bool removed_red;
+
+  ASSERT (tree != NULL);
+  ASSERT (elem != NULL);
+  ASSERT (tree->elem_cnt > 0);
+
+  if (elem->left == NULL || elem->right == NULL)
+    {
+      /* ELEM has at most one child, which takes its place. */
+      child = elem->left != NULL ? elem->left : elem->right;
+      parent = elem->parent;
+      removed_red = elem->red;
+      replace_child (tree, elem, child);
+      if (child != NULL)
+        child->parent = parent;
+    }
+  else
+    {
+      /* ELEM's successor, which has no left child, takes ELEM's
+         place and color.  The successor's right child takes
+         the successor's old place. */
+      struct rb_elem *next = leftmost (elem->right);
+
+      child = next->right;
+      removed_red = next->red;
+      if (next->parent == elem)
+        parent = next;
+      else
+        {
+          parent = next->parent;
+          parent->left = child;
+          if (child != NULL)
+            child->parent = parent;
+          next->right = elem->right;
+          next->right->parent = next;
+        }
+
+      replace_child (tree, elem, next);
+      next->parent = elem->parent;
+      next->left = elem->left;
+      next->left->parent = next;
+      next->red = elem->red;
+    }
+
+  /* Removing a black element shortens the paths through it. */
+  if (!removed_red)
+    remove_fixup (tree, child, parent);
+  tree->elem_cnt--;
+}
+
+/* Returns the first element in TREE that is equal to KEY, or a
+   null pointer if there is none. */
+struct rb_elem *
+rb_find (struct rb_tree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = rb_lower_bound (tree, key);
+
+  return e != NULL && !tree->less (key, e, tree->aux) ? e : NULL;
+}
+
+/* Returns the first element in TREE that is not less than KEY,
+   or a null pointer if there is none. */
+struct rb_elem *
+rb_lower_bound (struct rb_tree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (e, key, tree->aux))
+      e = e->right;
+    else
+      {
+        bound = e;
+        e = e->left;
+      }
+  return bound;
+}
+
+/* Returns the first element in TREE that is greater than KEY,
+   or a null pointer if there is none. */
+struct rb_elem *
+rb_upper_bound (struct rb_tree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (key, e, tree->aux))
+      {
+        bound = e;
+        e = e->left;
+      }
+    else
+      e = e->right;
+  return bound;
+}
+
+/* Returns the least element in TREE, or a null pointer if TREE
+   is empty. */
+struct rb_elem *
+rb_min (struct rb_tree *tree)
+{
+  ASSERT (tree != NULL);
+  return tree->root != NULL ? leftmost (tree->root) : NULL;
+}
+
+/* Returns the greatest element in TREE, or a null pointer if
+   TREE is empty. */
+struct rb_elem *
+rb_max (struct rb_tree *tree)
+{
+  ASSERT (tree != NULL);
+  return tree->root != NULL ? rightmost (tree->root) : NULL;
+}
+
+/* Returns the element after ELEM in its tree, or a null pointer
+   if ELEM is the greatest element. */
+struct rb_elem *
+rb_next (struct rb_elem *elem)
+{
+  ASSERT (elem != NULL);
+
+  if (elem->right != NULL)
+    return leftmost (elem->right);
+  while (elem->parent != NULL && elem == elem->parent->right)
+    elem = elem->parent;
+  return elem->parent;
+}
+
+/* Returns the element before ELEM in its tree, or a null pointer
+   if ELEM is the least element. */
+struct rb_elem *
+rb_prev (struct rb_elem *elem)
+{
+  ASSERT (elem != NULL);
+
+  if (elem->left != NULL)
+    return rightmost (elem->left);
+  while (elem->parent != NULL && elem == elem->parent->left)
+    elem = elem->parent;
+  return elem->parent;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (struct rb_tree *tree)
+{
+  return tree->elem_cnt;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (struct rb_tree *tree)
+{
+  return tree->root == NULL;
+}
+
+/* Returns true if E is red.  Null leaves are black. */
+static bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   the root of TREE.  Does not update NEW's parent pointer. */
+static void
+replace_child (struct rb_tree *tree, struct rb_elem *old,
+               struct rb_elem *new)
+{
+  if (old->parent == NULL)
+    tree->root = new;
+  else if (old == old->parent->left)
+    old->parent->left = new;
+  else
+    old->parent->right = new;
+}
+
+/* Rotates the subtree rooted at E to the left, so that E's
+   right child takes E's place and E becomes its left child. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  replace_child (tree, e, r);
+  r->parent = e->parent;
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E to the right, so that E's
+   left child takes E's place and E becomes its right child. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  replace_child (tree, e, l);
+  l->parent = e->parent;
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black properties after inserting red element
+   E, which may have a red parent. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *parent;
+
+  while ((parent = e->parent) != NULL && parent->red)
+    {
+      /* PARENT is red, so it is not the root and has a parent. */
+      struct rb_elem *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rb_elem *uncle = grandparent->right;
+
+          if (is_red (uncle))
+            {
+              /* Push the grandparent's blackness down a level
+                 and continue from the grandparent. */
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->right)
+            {
+              rotate_left (tree, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_right (tree, grandparent);
+        }
+      else
+        {
+          struct rb_elem *uncle = grandparent->left;
+
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->left)
+            {
+              rotate_right (tree, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_left (tree, grandparent);
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties after removing a black
+   element, whose place was taken by E, a child of PARENT.  E may
+   be a null leaf, which is why PARENT is passed separately.
+   Paths through E are one black element short. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_elem *e,
+              struct rb_elem *parent)
+{
+  while (e != tree->root && !is_red (e))
+    {
+      /* E is short a black element, so its sibling's subtree has
+         at least one black element and the sibling exists. */
+      if (e == parent->left)
+        {
+          struct rb_elem *sibling = parent->right;
+
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              /* Shorten the sibling's paths too and move the
+                 problem up a level. */
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->right))
+                {
+                  sibling->left->red = false;
+                  sibling->red = true;
+                  rotate_right (tree, sibling);
+                  sibling = parent->right;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->right->red = false;
+              rotate_left (tree, parent);
+              e = tree->root;
+            }
+        }
+      else
+        {
+          struct rb_elem *sibling = parent->left;
+
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->left))
+                {
+                  sibling->right->red = false;
+                  sibling->red = true;
+                  rotate_left (tree, sibling);
+                  sibling = parent->left;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->left->red = false;
+              rotate_right (tree, parent);
+              e = tree->root;
+            }
+        }
+    }
+  if (e != NULL)
+    e->red = false;
+}
+
+/* Returns the least element in the subtree rooted at E. */
+static struct rb_elem *
+leftmost (struct rb_elem *e)
+{
+  while (e->left != NULL)
+    e = e->left;
+  return e;
+}
+
+/* Returns the greatest element in the subtree rooted at E. */
+static struct rb_elem *
+rightmost (struct rb_elem *e)
+{
+  while (e->right != NULL)
+    e = e->right;
+  return e;
+}
@@ -0,0 +1,118 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree is a binary search tree that keeps itself
+   balanced, so that insertion, removal, and search take
+   O(log n) time, and in-order traversal visits the elements in
+   sorted order.  Use it instead of a list kept sorted with
+   list_insert_ordered() when the list can grow long.
+
+   Like lists, red-black trees do not use dynamically allocated
+   memory.  Each structure that is a potential tree element must
+   embed a struct rb_elem member, and the rb_entry macro converts
+   from a struct rb_elem back to the structure that contains it.
+   Refer to lib/kernel/list.h for a detailed explanation.
+
+   For example, a tree of `struct foo' ordered by `key':
+
+      struct foo
+        {
+          struct rb_elem elem;
+          int key;
+          ...other members...
+        };
+
+      static bool
+      foo_less (const struct rb_elem *a_, const struct rb_elem *b_,
+                void *aux UNUSED)
+      {
+        const struct foo *a = rb_entry (a_, struct foo, elem);
+        const struct foo *b = rb_entry (b_, struct foo, elem);
+
+        return a->key < b->key;
+      }
+
+      struct rb_tree foo_tree;
+
+      rb_init (&foo_tree, foo_less, NULL);
+
+   Iteration in sorted order:
+
+      struct rb_elem *e;
+
+      for (e = rb_min (&foo_tree); e != NULL; e = rb_next (e))
+        {
+          struct foo *f = rb_entry (e, struct foo, elem);
+          ...do something with f...
+        }
+
+   The tree may hold several equal elements.  An element is
+   inserted after any elements equal to it, so equal elements
+   keep their insertion order.
+
+   Searches take a key in the form of an element: fill in the
+   key fields of a struct foo on the stack and pass the address
+   of its `elem'.  Only LESS ever looks at it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null for the root. */
+    struct rb_elem *left;       /* Left child, or null. */
+    struct rb_elem *right;      /* Right child, or null. */
+    bool red;                   /* Red if true, black if false. */
+  };
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rb_tree
+  {
+    struct rb_elem *root;       /* Root, or null if empty. */
+    size_t elem_cnt;            /* Number of elements. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element.  See the big comment at the top of the file for
+   an example. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent             \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rb_tree *, struct rb_elem *);
+void rb_remove (struct rb_tree *, struct rb_elem *);
+
+/* Search. */
+struct rb_elem *rb_find (struct rb_tree *, const struct rb_elem *);
+struct rb_elem *rb_lower_bound (struct rb_tree *, const struct rb_elem *);
+struct rb_elem *rb_upper_bound (struct rb_tree *, const struct rb_elem *);
+
+/* Traversal. */
+struct rb_elem *rb_min (struct rb_tree *);
+struct rb_elem *rb_max (struct rb_tree *);
+struct rb_elem *rb_next (struct rb_elem *);
+struct rb_elem *rb_prev (struct rb_elem *);
+
+/* Tree properties. */
+size_t rb_size (struct rb_tree *);
+bool rb_empty (struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -1,5 +1,68 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The block memory functions below move or compare 32-bit words
+   at a time, using the x86 string instructions where they help,
+   and handle unaligned heads and tails a byte at a time.  Blocks
+   shorter than WORD_MIN bytes are not worth the setup.
+
+   The x86 allows unaligned word accesses, so only the
+   destination is aligned.  Words are accessed through the
+   may_alias type, since they may overlay objects of any type. */
+#define WORD_MIN 16
+typedef uint32_t __attribute__ ((may_alias)) word_t;
+
+/* The string functions below scan a word at a time once their
+   pointer is aligned, using the classic test for a zero byte in
+   a word.  An aligned word never crosses a page boundary, so
+   reading the whole word that contains a string's last byte
+   cannot fault even if the rest of the word is past the end. */
+#define ONES 0x01010101u
+#define HIGHS 0x80808080u
+
+/* Returns nonzero if word W contains a zero byte. */
+static inline uint32_t
+has_zero (uint32_t w) 
+{
+  return (w - ONES) & ~w & HIGHS;
+}
+
+/* Returns nonzero if word W contains a zero byte or a byte equal
+   to the byte replicated in each byte of MASK. */
+static inline uint32_t
+has_zero_or (uint32_t w, uint32_t mask) 
+{
+  return has_zero (w) | has_zero (w ^ mask);
+}
+
+/* A set of characters, one bit per possible byte value. */
+struct char_set 
+  {
+    uint32_t bits[256 / 32];
+  };
+
+/* Initializes SET to contain the characters in CHARS plus the
+   null character. */
+static void
+char_set_init (struct char_set *set, const char *chars) 
+{
+  const unsigned char *p = (const unsigned char *) chars;
+
+  memset (set, 0, sizeof *set);
+  set->bits[0] = 1;
+  for (; *p != '\0'; p++)
+    set->bits[*p / 32] |= 1u << (*p % 32);
+}
+
+/* Returns true if C is in SET. */
+static inline bool
+char_set_contains (const struct char_set *set, char c_) 
+{
+  unsigned char c = c_;
+  return (set->bits[c / 32] & (1u << (c % 32))) != 0;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +75,17 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_MIN) 
+    {
+      size_t words;
+
+      for (; ((uintptr_t) dst & 3) != 0; size--)
+        *dst++ = *src++;
+      words = size / 4;
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+      size %= 4;
+    }
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -29,20 +103,32 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
+  /* Copying forward is safe unless DST starts inside SRC. */
+  if (dst <= src || dst >= src + size) 
+    return memcpy (dst_, src_, size);
+
+  /* Copy backward, from the end. */
+  dst += size;
+  src += size;
+  if (size >= WORD_MIN) 
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
+      size_t words;
+
+      for (; ((uintptr_t) dst & 3) != 0; size--)
         *--dst = *--src;
+      words = size / 4;
+      dst -= 4;
+      src -= 4;
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+      dst += 4;
+      src += 4;
+      size %= 4;
     }
+  while (size-- > 0)
+    *--dst = *--src;
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +144,14 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip equal words.  The byte loop then finds the difference
+     within the first unequal word, if any. */
+  for (; size >= 4 && *(const word_t *) a == *(const word_t *) b; size -= 4)
+    {
+      a += 4;
+      b += 4;
+    }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -113,16 +207,25 @@ char *
 strchr (const char *string, int c_) 
 {
   char c = c_;
+  uint32_t mask = (unsigned char) c * ONES;
+  const word_t *w;
 
   ASSERT (string != NULL);
 
-  for (;;) 
+  for (; ((uintptr_t) string & 3) != 0; string++)
+    if (*string == c)
+      return (char *) string;
+    else if (*string == '\0')
+      return NULL;
+
+  for (w = (const word_t *) string; !has_zero_or (*w, mask); w++)
+    continue;
+
+  for (string = (const char *) w; ; string++)
     if (*string == c)
       return (char *) string;
     else if (*string == '\0')
       return NULL;
-    else
-      string++;
 }
 
 /* Returns the length of the initial substring of STRING that
@@ -130,11 +233,19 @@ strchr (const char *string, int c_)
 size_t
 strcspn (const char *string, const char *stop) 
 {
+  struct char_set set;
   size_t length;
 
-  for (length = 0; string[length] != '\0'; length++)
-    if (strchr (stop, string[length]) != NULL)
-      break;
+  /* Searching for at most one character is just strchr(). */
+  if (stop[0] == '\0' || stop[1] == '\0') 
+    {
+      const char *p = strchr (string, stop[0]);
+      return p != NULL ? (size_t) (p - string) : strlen (string);
+    }
+
+  char_set_init (&set, stop);
+  for (length = 0; !char_set_contains (&set, string[length]); length++)
+    continue;
   return length;
 }
 
@@ -144,10 +255,8 @@ strcspn (const char *string, const char *stop)
 char *
 strpbrk (const char *string, const char *stop) 
 {
-  for (; *string != '\0'; string++)
-    if (strchr (stop, *string) != NULL)
-      return (char *) string;
-  return NULL;
+  string += strcspn (string, stop);
+  return *string != '\0' ? (char *) string : NULL;
 }
 
 /* Returns a pointer to the last occurrence of C in STRING.
@@ -156,9 +265,33 @@ char *
 strrchr (const char *string, int c_) 
 {
   char c = c_;
+  uint32_t mask = (unsigned char) c * ONES;
   const char *p = NULL;
+  const word_t *w;
+
+  if (c == '\0')
+    return (char *) string + strlen (string);
+
+  for (; ((uintptr_t) string & 3) != 0; string++)
+    if (*string == '\0')
+      return (char *) p;
+    else if (*string == c)
+      p = string;
+
+  /* Skip words without C, remembering the last C found, until
+     the word that holds the null terminator. */
+  for (w = (const word_t *) string; !has_zero (*w); w++)
+    if (has_zero (*w ^ mask)) 
+      {
+        const char *q = (const char *) w;
+        int i;
 
-  for (; *string != '\0'; string++)
+        for (i = 0; i < 4; i++)
+          if (q[i] == c)
+            p = q + i;
+      }
+
+  for (string = (const char *) w; *string != '\0'; string++)
     if (*string == c)
       p = string;
   return (char *) p;
@@ -169,11 +302,14 @@ strrchr (const char *string, int c_)
 size_t
 strspn (const char *string, const char *skip) 
 {
+  struct char_set set;
   size_t length;
-  
-  for (length = 0; string[length] != '\0'; length++)
-    if (strchr (skip, string[length]) == NULL)
-      break;
+
+  /* The null character is always in SET, so take it back out. */
+  char_set_init (&set, skip);
+  set.bits[0] &= ~1u;
+  for (length = 0; char_set_contains (&set, string[length]); length++)
+    continue;
   return length;
 }
 
@@ -234,6 +370,7 @@ strstr (const char *haystack, const char *needle)
 char *
 strtok_r (char *s, const char *delimiters, char **save_ptr) 
 {
+  struct char_set set;
   char *token;
   
   ASSERT (delimiters != NULL);
@@ -245,12 +382,13 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
     s = *save_ptr;
   ASSERT (s != NULL);
 
+  /* The set of delimiters always includes the null byte at the
+     end of the string. */
+  char_set_init (&set, delimiters);
+
   /* Skip any DELIMITERS at our current position. */
-  while (strchr (delimiters, *s) != NULL) 
+  while (char_set_contains (&set, *s)) 
     {
-      /* strchr() will always return nonnull if we're searching
-         for a null byte, because every string contains a null
-         byte (at the end). */
       if (*s == '\0')
         {
           *save_ptr = s;
@@ -262,7 +400,7 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
 
   /* Skip any non-DELIMITERS up to the end of the string. */
   token = s;
-  while (strchr (delimiters, *s) == NULL)
+  while (!char_set_contains (&set, *s))
     s++;
   if (*s != '\0') 
     {
@@ -281,7 +419,19 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  if (size >= WORD_MIN) 
+    {
+      uint32_t word = (unsigned char) value * 0x01010101u;
+      size_t words;
+
+      for (; ((uintptr_t) dst & 3) != 0; size--)
+        *dst++ = value;
+      words = size / 4;
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (word) : "memory");
+      size %= 4;
+    }
   while (size-- > 0)
     *dst++ = value;
 
@@ -293,10 +443,18 @@ size_t
 strlen (const char *string) 
 {
   const char *p;
+  const word_t *w;
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
+  for (p = string; ((uintptr_t) p & 3) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+
+  for (w = (const word_t *) p; !has_zero (*w); w++)
+    continue;
+
+  for (p = (const char *) w; *p != '\0'; p++)
     continue;
   return p - string;
 }
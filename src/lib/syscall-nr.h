@@ -28,7 +28,14 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Heap management. */
+    SYS_SBRK,                   /* Change the size of the heap. */
+
+    /* Measurement. */
+    SYS_NSECS,                  /* Read the high-resolution clock. */
+    SYS_FSSTAT                  /* Obtain file system statistics. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,275 @@
+#include "coro.h"
+#include <malloc.h>
+#include <stdint.h>
+
+/* Coroutines.
+
+   A coroutine runs a function on a stack of its own until the
+   function returns or calls coro_exit().  Coroutines are
+   scheduled cooperatively: the running coroutine keeps the CPU
+   until it calls coro_yield(), which moves it to the back of the
+   run queue, or coro_wait(), which parks it on a wait queue
+   until another coroutine calls coro_wake() on that queue.
+   Because nothing else can run in between, coroutines need no
+   locks to share data, only wait queues to wait for each other.
+
+   The program's original thread of control, the one that runs
+   main(), is a coroutine too, with the process stack.  It
+   usually creates some coroutines and then calls coro_run(),
+   which lets the others run until none is ready.
+
+   Each coroutine lives in a single block from malloc(), with its
+   struct coro at the bottom and its stack growing down from the
+   top, much like a kernel thread in its page.  The kernel maps
+   heap pages only when they are first touched, so a coroutine
+   that uses little stack costs little memory, and a process can
+   afford thousands of them.
+
+   Pintos has no nonblocking I/O or readiness system call, so a
+   coroutine that calls read() or write() blocks the whole
+   process until the call completes.  Coroutines that wait for
+   each other, such as the stages of a pipeline or a server's
+   request handlers and its I/O loop, should do so with wait
+   queues. */
+
+/* Random value for struct coro's `magic' member, used to detect
+   stack overflow. */
+#define CORO_MAGIC 0xc0de1234
+
+/* A coroutine. */
+struct coro
+  {
+    uint8_t *stack;             /* Saved stack pointer. */
+    coro_func *function;        /* Function to run. */
+    void *aux;                  /* Auxiliary data for FUNCTION. */
+    struct coro *next;          /* Next in run queue or wait queue. */
+    unsigned magic;             /* Detects stack overflow. */
+  };
+
+/* coro_switch()'s stack frame, as set up for a new coroutine. */
+struct coro_switch_frame
+  {
+    uint32_t edi;               /* Saved %edi. */
+    uint32_t esi;               /* Saved %esi. */
+    uint32_t ebp;               /* Saved %ebp. */
+    uint32_t ebx;               /* Saved %ebx. */
+    void (*eip) (void);         /* Return address. */
+    void *ret;                  /* Return address for coro_start(). */
+  };
+
+void coro_switch (uint8_t **cur_sp, uint8_t *next_sp);
+
+/* The coroutine that runs main(). */
+static struct coro main_coro = { NULL, NULL, NULL, NULL, CORO_MAGIC };
+
+/* Running coroutine. */
+static struct coro *running = &main_coro;
+
+/* Coroutines ready to run, other than the running one. */
+static struct coro_queue ready_queue;
+
+/* Coroutine that exited, to be freed once off its stack. */
+static struct coro *dying;
+
+/* Number of coroutines, not counting main_coro. */
+static size_t coro_cnt;
+
+static void coro_start (void) NO_RETURN;
+static void schedule (void);
+static void schedule_tail (void);
+static void enqueue (struct coro_queue *, struct coro *);
+static struct coro *dequeue (struct coro_queue *);
+
+/* Creates a coroutine that will run FUNCTION, passing AUX as its
+   argument, and adds it to the run queue.  Returns the new
+   coroutine, or a null pointer if memory is not available.
+
+   The coroutine does not run until the running coroutine yields
+   or waits. */
+struct coro *
+coro_create (coro_func *function, void *aux)
+{
+  struct coro *c;
+  struct coro_switch_frame *sf;
+
+  ASSERT (function != NULL);
+
+  c = malloc (CORO_STACK_SIZE);
+  if (c == NULL)
+    return NULL;
+  c->function = function;
+  c->aux = aux;
+  c->magic = CORO_MAGIC;
+
+  /* Build a frame for coro_switch() to "return" into
+     coro_start(). */
+  sf = (struct coro_switch_frame *) ((uint8_t *) c + CORO_STACK_SIZE) - 1;
+  sf->ebp = 0;
+  sf->eip = coro_start;
+  sf->ret = NULL;
+  c->stack = (uint8_t *) sf;
+
+  coro_cnt++;
+  enqueue (&ready_queue, c);
+  return c;
+}
+
+/* Moves the running coroutine to the back of the run queue and
+   runs the coroutine at the front.  Returns immediately if no
+   other coroutine is ready. */
+void
+coro_yield (void)
+{
+  if (ready_queue.head != NULL)
+    {
+      enqueue (&ready_queue, running);
+      schedule ();
+    }
+}
+
+/* Ends the running coroutine, which must not be the one that
+   runs main(). */
+void
+coro_exit (void)
+{
+  ASSERT (running != &main_coro);
+
+  coro_cnt--;
+  dying = running;
+  schedule ();
+  NOT_REACHED ();
+}
+
+/* Runs other coroutines until none is ready, then returns.
+   Coroutines still parked on wait queues at that point stay
+   there; coro_count() says how many there are. */
+void
+coro_run (void)
+{
+  while (ready_queue.head != NULL)
+    coro_yield ();
+}
+
+/* Returns the running coroutine. */
+struct coro *
+coro_current (void)
+{
+  ASSERT (running->magic == CORO_MAGIC);
+  return running;
+}
+
+/* Returns the number of coroutines that have been created and
+   have not yet exited. */
+size_t
+coro_count (void)
+{
+  return coro_cnt;
+}
+
+/* Initializes Q as an empty wait queue. */
+void
+coro_queue_init (struct coro_queue *q)
+{
+  q->head = q->tail = NULL;
+}
+
+/* Parks the running coroutine on Q until another coroutine wakes
+   it.  Panics if no coroutine is left ready to run, since then
+   nothing could ever wake it. */
+void
+coro_wait (struct coro_queue *q)
+{
+  enqueue (q, running);
+  schedule ();
+}
+
+/* Moves the coroutine that has waited longest on Q to the back
+   of the run queue.  Returns true if there was one, false if Q
+   was empty.  Does not yield. */
+bool
+coro_wake (struct coro_queue *q)
+{
+  struct coro *c = dequeue (q);
+
+  if (c == NULL)
+    return false;
+  enqueue (&ready_queue, c);
+  return true;
+}
+
+/* Wakes every coroutine waiting on Q. */
+void
+coro_wake_all (struct coro_queue *q)
+{
+  while (coro_wake (q))
+    continue;
+}
+
+/* Runs the new coroutine's function, then ends the coroutine.
+   Entered from coro_switch() on the coroutine's fresh stack. */
+static void
+coro_start (void)
+{
+  schedule_tail ();
+  running->function (running->aux);
+  coro_exit ();
+}
+
+/* Switches from the running coroutine, which must already be on
+   a queue or exiting, to the one at the front of the run
+   queue. */
+static void
+schedule (void)
+{
+  struct coro *cur = running;
+  struct coro *next = dequeue (&ready_queue);
+
+  if (next == NULL)
+    PANIC ("all coroutines are waiting");
+  ASSERT (cur->magic == CORO_MAGIC);
+  ASSERT (next->magic == CORO_MAGIC);
+
+  if (next != cur)
+    {
+      running = next;
+      coro_switch (&cur->stack, next->stack);
+    }
+  schedule_tail ();
+}
+
+/* Completes a switch by freeing the coroutine that exited, if
+   any.  It could not free itself while still on its stack. */
+static void
+schedule_tail (void)
+{
+  if (dying != NULL)
+    {
+      dying->magic = 0;
+      free (dying);
+      dying = NULL;
+    }
+}
+
+/* Appends C to Q. */
+static void
+enqueue (struct coro_queue *q, struct coro *c)
+{
+  c->next = NULL;
+  if (q->head == NULL)
+    q->head = c;
+  else
+    q->tail->next = c;
+  q->tail = c;
+}
+
+/* Removes and returns the first coroutine in Q, or returns a null
+   pointer if Q is empty. */
+static struct coro *
+dequeue (struct coro_queue *q)
+{
+  struct coro *c = q->head;
+
+  if (c != NULL)
+    q->head = c->next;
+  return c;
+}
@@ -0,0 +1,38 @@
+#ifndef __LIB_USER_CORO_H
+#define __LIB_USER_CORO_H
+
+#include <debug.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Coroutines: cooperatively scheduled threads of control inside
+   one user process.  See coro.c for details. */
+
+struct coro;
+
+/* Function run by a coroutine. */
+typedef void coro_func (void *aux);
+
+/* Queue of coroutines waiting for something. */
+struct coro_queue
+  {
+    struct coro *head;          /* First waiter, or null. */
+    struct coro *tail;          /* Last waiter. */
+  };
+
+/* Stack size of each coroutine, including its bookkeeping. */
+#define CORO_STACK_SIZE (16 * 1024)
+
+struct coro *coro_create (coro_func *, void *aux);
+void coro_yield (void);
+void coro_exit (void) NO_RETURN;
+void coro_run (void);
+struct coro *coro_current (void);
+size_t coro_count (void);
+
+void coro_queue_init (struct coro_queue *);
+void coro_wait (struct coro_queue *);
+bool coro_wake (struct coro_queue *);
+void coro_wake_all (struct coro_queue *);
+
+#endif /* lib/user/coro.h */
@@ -0,0 +1,406 @@
+#include "malloc.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A user-space memory allocator built on sbrk().
+
+   Requests of up to SMALL_MAX bytes are rounded up to one of a
+   few dozen size classes.  Each size class has a cache: a free
+   list of blocks of that size, plus the unused tail of the span
+   that blocks of that size were most recently carved from.
+   malloc() pops a block off the free list or carves one from
+   the span, and free() pushes the block back on the free list,
+   so both are a handful of instructions in the common case.  A
+   Pintos user process has exactly one thread, so the caches
+   need no locking; in a multithreaded allocator they would be
+   per-thread caches in front of shared lists.
+
+   Spans, and blocks larger than SMALL_MAX, are allocated in
+   whole pages from the heap.  Freed runs of pages are kept in a
+   list sorted by address, coalesced with their neighbors, and
+   returned to the kernel with sbrk() when a large enough run
+   reaches the top of the heap.
+
+   free() finds the size of a block through the page map, which
+   records for each page of the heap which size class its blocks
+   belong to, or that it starts a large block.  The page map
+   covers the largest heap we support, but the kernel only
+   allocates heap pages when they are first touched, so the map
+   only costs memory for the parts of the heap actually used.
+   The same goes for a new span: its pages are only touched as
+   blocks are carved from it.
+
+   The allocator assumes that it is the only user of sbrk(), so
+   programs that use malloc() must not call sbrk() themselves. */
+
+/* Page size. */
+#define PGSIZE 4096
+
+/* Largest heap supported, in pages. */
+#define HEAP_PAGES (1024 * 1024 * 1024 / PGSIZE)
+
+/* Largest request served from a size class. */
+#define SMALL_MAX 2048
+
+/* Pages in a span of small blocks. */
+#define SPAN_PAGES 4
+
+/* Free runs at the top of the heap at least this many pages long
+   are returned to the kernel. */
+#define TRIM_PAGES 16
+
+/* Page map values other than size class numbers. */
+#define PAGE_UNUSED 0           /* Free, or inside a large block. */
+#define PAGE_LARGE 0xff         /* First page of a large block. */
+
+/* Block sizes of the size classes.  Sizes up to 128 bytes are
+   spaced 16 bytes apart; after that, there are four classes per
+   power of 2, so that rounding up wastes at most 25%. */
+static const uint16_t class_size[] =
+  {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+  };
+#define CLASS_CNT (sizeof class_size / sizeof *class_size)
+
+/* Free small block. */
+struct block
+  {
+    struct block *next;         /* Next free block of the same size. */
+  };
+
+/* Cache of blocks of one size class. */
+struct cache
+  {
+    struct block *free;         /* Free blocks, last freed first. */
+    uint8_t *span_next;         /* Next block never yet allocated. */
+    uint8_t *span_end;          /* End of the current span. */
+  };
+
+/* Header at the start of a large block.  Its size keeps the
+   block's data 16-byte aligned. */
+struct large
+  {
+    size_t page_cnt;            /* Number of pages in block. */
+    uint32_t reserved[3];
+  };
+
+/* Free run of pages. */
+struct run
+  {
+    size_t page_cnt;            /* Number of pages in run. */
+    struct run *next;           /* Next run, at a higher address. */
+  };
+
+static struct cache caches[CLASS_CNT];
+
+static uint8_t *page_map;       /* Size class of each heap page, plus 1. */
+static uint8_t *heap_base;      /* Start of pages covered by page_map. */
+static uint8_t *heap_top;       /* End of pages, the current break. */
+static struct run *free_runs;   /* Free runs of pages. */
+
+static size_t size_to_class (size_t);
+static size_t block_size (void *);
+static bool new_span (size_t class);
+static void *large_alloc (size_t);
+static void large_free (struct large *);
+static size_t page_no (const void *);
+static void *pages_alloc (size_t page_cnt);
+static void pages_free (void *, size_t page_cnt);
+static uint8_t *run_end (const struct run *);
+static bool heap_init (void);
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  if (size <= SMALL_MAX)
+    {
+      size_t class = size_to_class (size);
+      struct cache *c = &caches[class];
+      struct block *b = c->free;
+
+      if (b != NULL)
+        {
+          c->free = b->next;
+          return b;
+        }
+
+      if (c->span_next == c->span_end && !new_span (class))
+        return NULL;
+      b = (struct block *) c->span_next;
+      c->span_next += class_size[class];
+      return b;
+    }
+  else
+    return large_alloc (size);
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  size = a * b;
+  if (b != 0 && size / b != a)
+    return NULL;
+
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+  return p;
+}
+
+/* Returns the number of bytes that can be stored in block P. */
+static size_t
+block_size (void *p)
+{
+  unsigned char class = page_map[page_no (p)];
+
+  ASSERT (class != PAGE_UNUSED);
+  if (class != PAGE_LARGE)
+    return class_size[class - 1];
+  else
+    return (((struct large *) p - 1)->page_cnt * PGSIZE
+            - sizeof (struct large));
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  else if (old_block == NULL)
+    return malloc (new_size);
+  else
+    {
+      size_t old_size = block_size (old_block);
+      void *new_block;
+
+      /* Keep the block if it is big enough and not much too
+         big. */
+      if (new_size <= old_size && new_size >= old_size / 2)
+        return old_block;
+
+      new_block = malloc (new_size);
+      if (new_block != NULL)
+        {
+          memcpy (new_block, old_block,
+                  old_size < new_size ? old_size : new_size);
+          free (old_block);
+        }
+      return new_block;
+    }
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  if (p != NULL)
+    {
+      unsigned char class = page_map[page_no (p)];
+
+      ASSERT (class != PAGE_UNUSED);
+      if (class != PAGE_LARGE)
+        {
+          struct cache *c = &caches[class - 1];
+          struct block *b = p;
+
+          b->next = c->free;
+          c->free = b;
+        }
+      else
+        large_free ((struct large *) p - 1);
+    }
+}
+
+/* Returns the number of the size class for SIZE bytes, which
+   must not exceed SMALL_MAX. */
+static size_t
+size_to_class (size_t size)
+{
+  if (size <= 128)
+    return size <= 16 ? 0 : (size - 1) >> 4;
+  else
+    {
+      /* SHIFT is the position of the most significant 1-bit in
+         SIZE - 1, from 7 to 10.  Each power of 2 has four
+         classes, selected by the next two bits. */
+      int shift = 31 - __builtin_clz (size - 1);
+      return 8 + (shift - 7) * 4 + (((size - 1) >> (shift - 2)) & 3);
+    }
+}
+
+/* Gives CLASS's cache a new span to carve blocks from.  Returns
+   true if successful, false if memory is not available. */
+static bool
+new_span (size_t class)
+{
+  struct cache *c = &caches[class];
+  size_t size = class_size[class];
+  uint8_t *span = pages_alloc (SPAN_PAGES);
+  size_t i;
+
+  if (span == NULL)
+    return false;
+
+  for (i = 0; i < SPAN_PAGES; i++)
+    page_map[page_no (span) + i] = class + 1;
+  c->span_next = span;
+  c->span_end = span + (SPAN_PAGES * PGSIZE) / size * size;
+  return true;
+}
+
+/* Allocates a block of SIZE bytes, more than SMALL_MAX, in pages
+   of its own. */
+static void *
+large_alloc (size_t size)
+{
+  size_t page_cnt;
+  struct large *l;
+
+  if (size > HEAP_PAGES * PGSIZE)
+    return NULL;
+  page_cnt = DIV_ROUND_UP (size + sizeof *l, PGSIZE);
+  l = pages_alloc (page_cnt);
+  if (l == NULL)
+    return NULL;
+
+  l->page_cnt = page_cnt;
+  page_map[page_no (l)] = PAGE_LARGE;
+  return l + 1;
+}
+
+/* Frees large block L. */
+static void
+large_free (struct large *l)
+{
+  page_map[page_no (l)] = PAGE_UNUSED;
+  pages_free (l, l->page_cnt);
+}
+
+/* Returns the number of the heap page that contains P. */
+static size_t
+page_no (const void *p)
+{
+  ASSERT ((const uint8_t *) p >= heap_base
+          && (const uint8_t *) p < heap_top);
+  return ((const uint8_t *) p - heap_base) / PGSIZE;
+}
+
+/* Allocates PAGE_CNT contiguous pages, taking them from the end
+   of the first free run big enough or, failing that, from the
+   kernel.  Returns a null pointer if memory is not available. */
+static void *
+pages_alloc (size_t page_cnt)
+{
+  struct run **rp;
+  uint8_t *pages;
+
+  for (rp = &free_runs; *rp != NULL; rp = &(*rp)->next)
+    {
+      struct run *r = *rp;
+
+      if (r->page_cnt > page_cnt)
+        {
+          r->page_cnt -= page_cnt;
+          return (uint8_t *) r + r->page_cnt * PGSIZE;
+        }
+      else if (r->page_cnt == page_cnt)
+        {
+          *rp = r->next;
+          return r;
+        }
+    }
+
+  if (heap_base == NULL && !heap_init ())
+    return NULL;
+  if (page_cnt > HEAP_PAGES - (size_t) (heap_top - heap_base) / PGSIZE)
+    return NULL;
+  pages = sbrk (page_cnt * PGSIZE);
+  if (pages == (void *) -1)
+    return NULL;
+  ASSERT (pages == heap_top);
+  heap_top += page_cnt * PGSIZE;
+  return pages;
+}
+
+/* Frees the PAGE_CNT pages starting at P, merging them with
+   adjacent free runs.  If this leaves a long free run at the top
+   of the heap, returns it to the kernel. */
+static void
+pages_free (void *p, size_t page_cnt)
+{
+  struct run *r = p;
+  struct run **rp, **prev_rp = NULL;
+
+  /* Insert R into the list in address order. */
+  for (rp = &free_runs; *rp != NULL && *rp < r; rp = &(*rp)->next)
+    prev_rp = rp;
+  r->page_cnt = page_cnt;
+  r->next = *rp;
+  *rp = r;
+
+  /* Merge with the following and preceding runs. */
+  if (r->next != NULL && run_end (r) == (uint8_t *) r->next)
+    {
+      r->page_cnt += r->next->page_cnt;
+      r->next = r->next->next;
+    }
+  if (prev_rp != NULL && run_end (*prev_rp) == (uint8_t *) r)
+    {
+      (*prev_rp)->page_cnt += r->page_cnt;
+      (*prev_rp)->next = r->next;
+      rp = prev_rp;
+      r = *rp;
+    }
+
+  if (run_end (r) == heap_top && r->page_cnt >= TRIM_PAGES
+      && sbrk (-(intptr_t) (r->page_cnt * PGSIZE)) != (void *) -1)
+    {
+      heap_top = (uint8_t *) r;
+      *rp = NULL;
+    }
+}
+
+/* Returns the end of run R. */
+static uint8_t *
+run_end (const struct run *r)
+{
+  return (uint8_t *) r + r->page_cnt * PGSIZE;
+}
+
+/* Reserves address space for the page map and sets up an empty
+   heap above it.  Returns true if successful. */
+static bool
+heap_init (void)
+{
+  uint8_t *brk = sbrk (0);
+  size_t pad = ROUND_UP ((uintptr_t) brk, PGSIZE) - (uintptr_t) brk;
+
+  if (sbrk (pad + HEAP_PAGES) == (void *) -1)
+    return false;
+  page_map = brk + pad;
+  heap_base = heap_top = page_map + HEAP_PAGES;
+  return true;
+}
@@ -0,0 +1,686 @@
+#include <stdio.h>
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Buffered streams.
+
+   Each stream has a buffer, BUFSIZ bytes by default, that
+   collects small reads and writes into few large system calls.
+   A read that finds the buffer empty refills all of it, and a
+   write that fills the buffer writes all of it out.  Requests at
+   least as large as the buffer skip it and go straight to the
+   system call.
+
+   A stream is either reading, with the buffer holding data read
+   ahead of the caller, or writing, with the buffer holding data
+   not yet written, or neither.  Switching between reading and
+   writing flushes pending output or discards read-ahead data
+   and seeks back to the logical position.
+
+   Buffered output is written by fflush(), by fclose(), when the
+   buffer fills, after each new-line in a line-buffered stream,
+   and when the program calls exit() or returns from main(). */
+
+/* Stream flags. */
+#define STREAM_READ     0x01    /* Opened for reading. */
+#define STREAM_WRITE    0x02    /* Opened for writing. */
+#define STREAM_APPEND   0x04    /* Start at end of file. */
+#define STREAM_TRUNCATE 0x08    /* Discard old contents. */
+#define STREAM_OWN_BUF  0x10    /* Buffer allocated with malloc(). */
+#define STREAM_STATIC   0x20    /* Stream itself not malloc()'d. */
+#define STREAM_EOF      0x40    /* End of file reached. */
+#define STREAM_ERROR    0x80    /* I/O error occurred. */
+
+/* What the buffer holds. */
+enum stream_state
+  {
+    STREAM_IDLE,                /* Nothing. */
+    STREAM_READING,             /* Data read ahead. */
+    STREAM_WRITING              /* Data not yet written. */
+  };
+
+/* A buffered stream. */
+struct stream
+  {
+    int fd;                     /* File descriptor. */
+    int flags;                  /* STREAM_* flags. */
+    enum stream_state state;    /* What the buffer holds. */
+    int mode;                   /* _IOFBF, _IOLBF, or _IONBF. */
+    uint8_t *buf;               /* Buffer, or null if not yet set up. */
+    size_t size;                /* Buffer size. */
+    size_t pos;                 /* Reading: offset of next byte.
+                                   Writing: number of bytes buffered. */
+    size_t end;                 /* Reading: end of data in buffer. */
+    uint8_t ch;                 /* Buffer for unbuffered streams. */
+    struct stream *next;        /* Next open stream. */
+  };
+
+static struct stream stderr_stream =
+  {
+    STDOUT_FILENO, STREAM_WRITE | STREAM_STATIC, STREAM_IDLE, _IONBF,
+    NULL, 0, 0, 0, 0, NULL
+  };
+static struct stream stdout_stream =
+  {
+    STDOUT_FILENO, STREAM_WRITE | STREAM_STATIC, STREAM_IDLE, _IOLBF,
+    NULL, BUFSIZ, 0, 0, 0, &stderr_stream
+  };
+static struct stream stdin_stream =
+  {
+    STDIN_FILENO, STREAM_READ | STREAM_STATIC, STREAM_IDLE, _IONBF,
+    NULL, 0, 0, 0, 0, &stdout_stream
+  };
+
+FILE *stdin = &stdin_stream;
+FILE *stdout = &stdout_stream;
+FILE *stderr = &stderr_stream;
+
+/* All open streams. */
+static struct stream *streams = &stdin_stream;
+
+void __flush_streams (void);
+
+static int parse_mode (const char *);
+static struct stream *new_stream (int fd, int flags);
+static void set_up_buffer (struct stream *);
+static bool begin_read (struct stream *);
+static bool begin_write (struct stream *);
+static bool fill_buffer (struct stream *);
+static bool flush_buffer (struct stream *);
+static size_t stream_read (struct stream *, uint8_t *, size_t);
+static size_t stream_write (struct stream *, const uint8_t *, size_t);
+
+/* Opens the file named NAME and returns a stream for it, or a
+   null pointer if unsuccessful.  MODE is "r" to read, "w" to
+   write a new, empty file, or "a" to write at the end of a file,
+   which is created if necessary.  A "+" in MODE allows both
+   reading and writing; a "b" is ignored. */
+FILE *
+fopen (const char *name, const char *mode)
+{
+  int flags = parse_mode (mode);
+  struct stream *s;
+  int fd;
+
+  if (flags == 0)
+    return NULL;
+
+  /* Pintos cannot truncate a file, so replace it instead. */
+  if (flags & STREAM_TRUNCATE)
+    {
+      remove (name);
+      if (!create (name, 0))
+        return NULL;
+    }
+  else if (flags & STREAM_APPEND)
+    create (name, 0);
+
+  fd = open (name);
+  if (fd < 0)
+    return NULL;
+  if (flags & STREAM_APPEND)
+    seek (fd, filesize (fd));
+
+  s = new_stream (fd, flags);
+  if (s == NULL)
+    close (fd);
+  return s;
+}
+
+/* Returns a new stream for file descriptor FD, which must already
+   be open, or a null pointer if unsuccessful.  MODE is as for
+   fopen(), except that "w" does not discard the file's contents
+   and "a" does not seek to the end of the file. */
+FILE *
+fdopen (int fd, const char *mode)
+{
+  int flags = parse_mode (mode);
+
+  if (flags == 0)
+    return NULL;
+  return new_stream (fd, flags & ~(STREAM_TRUNCATE | STREAM_APPEND));
+}
+
+/* Flushes and closes stream S.  Returns 0 if successful, EOF if
+   buffered data could not be written. */
+int
+fclose (FILE *s)
+{
+  struct stream **sp;
+  int retval = fflush (s);
+
+  for (sp = &streams; *sp != s; sp = &(*sp)->next)
+    ASSERT (*sp != NULL);
+  *sp = s->next;
+
+  if (s->fd != STDIN_FILENO && s->fd != STDOUT_FILENO)
+    close (s->fd);
+  if (s->flags & STREAM_OWN_BUF)
+    free (s->buf);
+  if (!(s->flags & STREAM_STATIC))
+    free (s);
+  return retval;
+}
+
+/* Sets the buffering MODE of stream S to _IOFBF, _IOLBF, or
+   _IONBF.  Unless MODE is _IONBF, S will use the SIZE bytes at
+   BUF as its buffer or, if BUF is null, allocate a buffer of
+   SIZE bytes.  Must be called before any I/O on S.  Returns 0 if
+   successful, nonzero otherwise. */
+int
+setvbuf (FILE *s, char *buf, int mode, size_t size)
+{
+  if (s->buf != NULL
+      || (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+      || (mode != _IONBF && size == 0))
+    return EOF;
+
+  s->mode = mode;
+  s->size = size;
+  s->buf = mode != _IONBF ? (uint8_t *) buf : NULL;
+  return 0;
+}
+
+/* Writes any buffered output in stream S, or in all streams if S
+   is null.  Returns 0 if successful, EOF on error. */
+int
+fflush (FILE *s)
+{
+  if (s == NULL)
+    {
+      int retval = 0;
+
+      for (s = streams; s != NULL; s = s->next)
+        if (fflush (s) == EOF)
+          retval = EOF;
+      return retval;
+    }
+
+  if (s->state == STREAM_WRITING && !flush_buffer (s))
+    return EOF;
+  return 0;
+}
+
+/* Reads up to CNT objects of SIZE bytes each from stream S into
+   BUF.  Returns the number of whole objects read, which is less
+   than CNT only at end of file or on error. */
+size_t
+fread (void *buf, size_t size, size_t cnt, FILE *s)
+{
+  if (size == 0 || cnt == 0)
+    return 0;
+  return stream_read (s, buf, size * cnt) / size;
+}
+
+/* Writes CNT objects of SIZE bytes each from BUF to stream S.
+   Returns the number of whole objects written, which is less
+   than CNT only on error. */
+size_t
+fwrite (const void *buf, size_t size, size_t cnt, FILE *s)
+{
+  if (size == 0 || cnt == 0)
+    return 0;
+  return stream_write (s, buf, size * cnt) / size;
+}
+
+/* Reads and returns the next byte from stream S, or EOF at end
+   of file or on error. */
+int
+fgetc (FILE *s)
+{
+  uint8_t c;
+
+  if (s->state == STREAM_READING && s->pos < s->end)
+    return s->buf[s->pos++];
+  return stream_read (s, &c, 1) == 1 ? c : EOF;
+}
+
+/* Reads a line from stream S into STR, which has room for SIZE
+   bytes, including the new-line that ends the line and a null
+   terminator.  Reads at most SIZE - 1 bytes, stopping after a
+   new-line.  Returns STR, or a null pointer if nothing could be
+   read because of end of file or an error. */
+char *
+fgets (char *str, int size, FILE *s)
+{
+  char *p = str;
+
+  if (size <= 0 || !begin_read (s))
+    return NULL;
+
+  while (size > 1)
+    {
+      const uint8_t *nl;
+      size_t n;
+
+      if (s->pos == s->end && !fill_buffer (s))
+        break;
+
+      /* Copy up to and including a new-line in the buffer. */
+      n = s->end - s->pos;
+      if (n > (size_t) size - 1)
+        n = size - 1;
+      nl = memchr (s->buf + s->pos, '\n', n);
+      if (nl != NULL)
+        n = nl - (s->buf + s->pos) + 1;
+      memcpy (p, s->buf + s->pos, n);
+      s->pos += n;
+      p += n;
+      size -= n;
+      if (nl != NULL)
+        break;
+    }
+
+  if (p == str)
+    return NULL;
+  *p = '\0';
+  return str;
+}
+
+/* Writes byte C to stream S.  Returns C if successful, EOF on
+   error. */
+int
+fputc (int c, FILE *s)
+{
+  uint8_t byte = c;
+
+  if (s->state == STREAM_WRITING && s->mode == _IOFBF
+      && s->pos + 1 < s->size)
+    {
+      s->buf[s->pos++] = byte;
+      return byte;
+    }
+  return stream_write (s, &byte, 1) == 1 ? byte : EOF;
+}
+
+/* Writes string STR, without a new-line, to stream S.  Returns 0
+   if successful, EOF on error. */
+int
+fputs (const char *str, FILE *s)
+{
+  size_t length = strlen (str);
+
+  return stream_write (s, (const uint8_t *) str, length) == length ? 0 : EOF;
+}
+
+/* Like printf(), but writes output to stream S. */
+int
+fprintf (FILE *s, const char *format, ...)
+{
+  va_list args;
+  int retval;
+
+  va_start (args, format);
+  retval = vfprintf (s, format, args);
+  va_end (args);
+
+  return retval;
+}
+
+/* Auxiliary data for vfprintf_helper(). */
+struct vfprintf_aux
+  {
+    char buf[64];               /* Character buffer. */
+    char *p;                    /* Current position in buffer. */
+    int char_cnt;               /* Total characters written so far. */
+    FILE *stream;               /* Output stream. */
+  };
+
+static void vfprintf_helper (char, void *);
+
+/* Like vprintf(), but writes output to stream S. */
+int
+vfprintf (FILE *s, const char *format, va_list args)
+{
+  struct vfprintf_aux aux;
+
+  aux.p = aux.buf;
+  aux.char_cnt = 0;
+  aux.stream = s;
+  __vprintf (format, args, vfprintf_helper, &aux);
+  stream_write (s, (uint8_t *) aux.buf, aux.p - aux.buf);
+  return aux.char_cnt;
+}
+
+/* Adds C to the buffer in AUX, writing the buffer to the stream
+   when it fills up. */
+static void
+vfprintf_helper (char c, void *aux_)
+{
+  struct vfprintf_aux *aux = aux_;
+
+  *aux->p++ = c;
+  if (aux->p >= aux->buf + sizeof aux->buf)
+    {
+      stream_write (aux->stream, (uint8_t *) aux->buf, sizeof aux->buf);
+      aux->p = aux->buf;
+    }
+  aux->char_cnt++;
+}
+
+/* Sets the position of stream S to OFFSET bytes from WHENCE,
+   which is SEEK_SET, SEEK_CUR, or SEEK_END.  Returns 0 if
+   successful, -1 on error. */
+int
+fseek (FILE *s, long offset, int whence)
+{
+  long base;
+
+  switch (whence)
+    {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = ftell (s);
+      break;
+    case SEEK_END:
+      base = filesize (s->fd);
+      break;
+    default:
+      return -1;
+    }
+  if (base < 0 || base + offset < 0 || fflush (s) == EOF)
+    return -1;
+
+  seek (s->fd, base + offset);
+  s->state = STREAM_IDLE;
+  s->pos = s->end = 0;
+  s->flags &= ~STREAM_EOF;
+  return 0;
+}
+
+/* Returns the current position in stream S. */
+long
+ftell (FILE *s)
+{
+  long pos = tell (s->fd);
+
+  if (s->state == STREAM_READING)
+    pos -= s->end - s->pos;
+  else if (s->state == STREAM_WRITING)
+    pos += s->pos;
+  return pos;
+}
+
+/* Returns nonzero if a read from stream S reached end of file. */
+int
+feof (FILE *s)
+{
+  return (s->flags & STREAM_EOF) != 0;
+}
+
+/* Returns nonzero if an I/O error occurred on stream S. */
+int
+ferror (FILE *s)
+{
+  return (s->flags & STREAM_ERROR) != 0;
+}
+
+/* Clears the end-of-file and error indicators of stream S. */
+void
+clearerr (FILE *s)
+{
+  s->flags &= ~(STREAM_EOF | STREAM_ERROR);
+}
+
+/* Returns the file descriptor underlying stream S. */
+int
+fileno (FILE *s)
+{
+  return s->fd;
+}
+
+/* Writes the output buffered in every stream.  Called by
+   exit(). */
+void
+__flush_streams (void)
+{
+  fflush (NULL);
+}
+
+/* Parses fopen() MODE string and returns the corresponding
+   STREAM_* flags, or 0 if MODE is invalid. */
+static int
+parse_mode (const char *mode)
+{
+  int flags;
+
+  switch (*mode++)
+    {
+    case 'r':
+      flags = STREAM_READ;
+      break;
+    case 'w':
+      flags = STREAM_WRITE | STREAM_TRUNCATE;
+      break;
+    case 'a':
+      flags = STREAM_WRITE | STREAM_APPEND;
+      break;
+    default:
+      return 0;
+    }
+
+  for (; *mode != '\0'; mode++)
+    if (*mode == '+')
+      flags |= STREAM_READ | STREAM_WRITE;
+    else if (*mode != 'b')
+      return 0;
+  return flags;
+}
+
+/* Allocates and returns a fully buffered stream for FD with the
+   given FLAGS, or a null pointer if memory is not available. */
+static struct stream *
+new_stream (int fd, int flags)
+{
+  struct stream *s = malloc (sizeof *s);
+
+  if (s == NULL)
+    return NULL;
+  s->fd = fd;
+  s->flags = flags;
+  s->state = STREAM_IDLE;
+  s->mode = _IOFBF;
+  s->buf = NULL;
+  s->size = BUFSIZ;
+  s->pos = s->end = 0;
+  s->next = streams;
+  streams = s;
+  return s;
+}
+
+/* Gives stream S a buffer, if it does not have one yet.  If a
+   buffer cannot be allocated, makes S unbuffered. */
+static void
+set_up_buffer (struct stream *s)
+{
+  if (s->buf != NULL)
+    return;
+
+  if (s->mode != _IONBF)
+    {
+      s->buf = malloc (s->size);
+      if (s->buf != NULL)
+        {
+          s->flags |= STREAM_OWN_BUF;
+          return;
+        }
+      s->mode = _IONBF;
+    }
+  s->buf = &s->ch;
+  s->size = 1;
+}
+
+/* Prepares stream S for reading.  Returns true if successful,
+   false if S is not open for reading or pending output could not
+   be written. */
+static bool
+begin_read (struct stream *s)
+{
+  if (s->state == STREAM_READING)
+    return true;
+  if (!(s->flags & STREAM_READ))
+    {
+      s->flags |= STREAM_ERROR;
+      return false;
+    }
+
+  /* Output to a line-buffered stream, such as the console, is
+     flushed before reading from any stream, so that prompts
+     appear before the program waits for input. */
+  if (stdout->state == STREAM_WRITING && stdout->mode == _IOLBF)
+    flush_buffer (stdout);
+  if (s->state == STREAM_WRITING && !flush_buffer (s))
+    return false;
+
+  set_up_buffer (s);
+  s->state = STREAM_READING;
+  s->pos = s->end = 0;
+  return true;
+}
+
+/* Prepares stream S for writing.  Returns true if successful,
+   false if S is not open for writing. */
+static bool
+begin_write (struct stream *s)
+{
+  if (s->state == STREAM_WRITING)
+    return true;
+  if (!(s->flags & STREAM_WRITE))
+    {
+      s->flags |= STREAM_ERROR;
+      return false;
+    }
+
+  /* Discard read-ahead data, moving the file position back to
+     where the caller thinks it is. */
+  if (s->state == STREAM_READING && s->pos < s->end)
+    seek (s->fd, tell (s->fd) - (s->end - s->pos));
+
+  set_up_buffer (s);
+  s->state = STREAM_WRITING;
+  s->pos = s->end = 0;
+  return true;
+}
+
+/* Reads as much as fits into the buffer of stream S, which must
+   be reading with an empty buffer.  Returns true if successful,
+   false at end of file or on error. */
+static bool
+fill_buffer (struct stream *s)
+{
+  int n = read (s->fd, s->buf, s->size);
+
+  if (n <= 0)
+    {
+      s->flags |= n == 0 ? STREAM_EOF : STREAM_ERROR;
+      return false;
+    }
+  s->pos = 0;
+  s->end = n;
+  return true;
+}
+
+/* Writes out the data buffered in stream S, which must be
+   writing.  Returns true if successful, false on error. */
+static bool
+flush_buffer (struct stream *s)
+{
+  size_t ofs = 0;
+
+  while (ofs < s->pos)
+    {
+      int n = write (s->fd, s->buf + ofs, s->pos - ofs);
+      if (n <= 0)
+        {
+          s->flags |= STREAM_ERROR;
+          memmove (s->buf, s->buf + ofs, s->pos - ofs);
+          s->pos -= ofs;
+          return false;
+        }
+      ofs += n;
+    }
+  s->pos = 0;
+  return true;
+}
+
+/* Reads up to SIZE bytes from stream S into BUF.  Returns the
+   number of bytes read. */
+static size_t
+stream_read (struct stream *s, uint8_t *buf, size_t size)
+{
+  size_t ofs = 0;
+
+  if (!begin_read (s))
+    return 0;
+
+  while (ofs < size)
+    {
+      size_t left = size - ofs;
+
+      if (s->pos < s->end)
+        {
+          size_t n = s->end - s->pos < left ? s->end - s->pos : left;
+          memcpy (buf + ofs, s->buf + s->pos, n);
+          s->pos += n;
+          ofs += n;
+        }
+      else if (left >= s->size)
+        {
+          /* Too big to be worth buffering. */
+          int n = read (s->fd, buf + ofs, left);
+          if (n <= 0)
+            {
+              s->flags |= n == 0 ? STREAM_EOF : STREAM_ERROR;
+              break;
+            }
+          ofs += n;
+        }
+      else if (!fill_buffer (s))
+        break;
+    }
+  return ofs;
+}
+
+/* Writes SIZE bytes from BUF to stream S.  Returns the number of
+   bytes written or buffered. */
+static size_t
+stream_write (struct stream *s, const uint8_t *buf, size_t size)
+{
+  size_t ofs = 0;
+
+  if (!begin_write (s))
+    return 0;
+
+  while (ofs < size)
+    {
+      size_t left = size - ofs;
+
+      if (s->pos == 0 && left >= s->size)
+        {
+          /* Too big to be worth buffering. */
+          int n = write (s->fd, buf + ofs, left);
+          if (n <= 0)
+            {
+              s->flags |= STREAM_ERROR;
+              break;
+            }
+          ofs += n;
+        }
+      else
+        {
+          size_t n = s->size - s->pos < left ? s->size - s->pos : left;
+          memcpy (s->buf + s->pos, buf + ofs, n);
+          s->pos += n;
+          ofs += n;
+          if (s->pos == s->size && !flush_buffer (s))
+            break;
+        }
+    }
+
+  if (s->mode == _IOLBF && s->pos > 0 && memchr (buf, '\n', ofs) != NULL)
+    flush_buffer (s);
+  return ofs;
+}
@@ -68,9 +68,14 @@ halt (void)
   NOT_REACHED ();
 }
 
+/* Flushes buffered streams, if the program uses any. */
+void __flush_streams (void) __attribute__ ((weak));
+
 void
 exit (int status)
 {
+  if (__flush_streams)
+    __flush_streams ();
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -182,3 +187,30 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+/* Returns the number of nanoseconds since the kernel started.
+   The kernel returns the 64-bit result in %edx:%eax, which the
+   syscall macros cannot express. */
+int64_t
+nsecs (void)
+{
+  int64_t retval;
+
+  asm volatile ("pushl %[number]; int $0x30; addl $4, %%esp"
+                : "=A" (retval)
+                : [number] "i" (SYS_NSECS)
+                : "memory");
+  return retval;
+}
+
+bool
+fsstat (struct fsstat *stats)
+{
+  return syscall1 (SYS_FSSTAT, stats);
+}
@@ -2,6 +2,7 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* Process identifier. */
@@ -45,4 +46,23 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Heap management. */
+void *sbrk (intptr_t increment);
+
+/* File system statistics, as reported by fsstat().  All counts
+   are totals since the kernel started. */
+struct fsstat
+  {
+    unsigned long long cache_hits;      /* Buffer cache hits. */
+    unsigned long long cache_misses;    /* Buffer cache misses. */
+    unsigned long long cache_evictions; /* Blocks evicted from cache. */
+    unsigned long long cache_read_aheads; /* Blocks read ahead. */
+    unsigned long long dev_reads;       /* Sectors read from device. */
+    unsigned long long dev_writes;      /* Sectors written to device. */
+  };
+
+/* Measurement. */
+int64_t nsecs (void);
+bool fsstat (struct fsstat *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,72 @@
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+
+/* Kernel microbenchmarks.
+
+   Each benchmark measures one kernel primitive with
+   timer_nsecs() and reports its results with bench_report(), in
+   the format that "make bench" collects (see tests/Make.tests). */
+
+struct bench
+  {
+    const char *name;
+    bench_func *function;
+  };
+
+static const struct bench benches[] =
+  {
+    {"bench-ctxsw", bench_ctxsw},
+    {"bench-lock", bench_lock},
+    {"bench-sema", bench_sema},
+    {"bench-malloc", bench_malloc},
+    {"bench-palloc", bench_palloc},
+    {"bench-sleep", bench_sleep},
+    {"bench-thread-create", bench_thread_create},
+  };
+
+/* Name of the running benchmark, without the "bench-" prefix. */
+static const char *bench_name;
+
+/* Runs the benchmark named NAME, or all of them if NAME is
+   "bench-all".  Returns false if there is no such benchmark. */
+bool
+run_bench (const char *name)
+{
+  const struct bench *b;
+  bool all = !strcmp (name, "bench-all");
+  bool found = false;
+
+  for (b = benches; b < benches + sizeof benches / sizeof *benches; b++)
+    if (all || !strcmp (name, b->name))
+      {
+        bench_name = b->name + strlen ("bench-");
+        b->function ();
+        found = true;
+      }
+  return found;
+}
+
+/* Reports VALUE, in UNIT, as the result of METRIC for the running
+   benchmark. */
+void
+bench_report (const char *metric, int64_t value, const char *unit)
+{
+  ASSERT (strchr (metric, ' ') == NULL);
+  printf ("bench %s %s %"PRId64" %s\n", bench_name, metric, value, unit);
+}
+
+/* Reports the average time taken by each of OP_CNT operations
+   that started at time START, as returned by timer_nsecs(), and
+   have just finished. */
+void
+bench_report_time (const char *metric, int64_t start, int64_t op_cnt)
+{
+  int64_t elapsed = timer_nsecs () - start;
+
+  ASSERT (op_cnt > 0);
+  bench_report (metric, elapsed / op_cnt, "ns/op");
+}
@@ -0,0 +1,22 @@
+#ifndef TESTS_BENCH_BENCH_H
+#define TESTS_BENCH_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool run_bench (const char *);
+
+typedef void bench_func (void);
+
+extern bench_func bench_ctxsw;
+extern bench_func bench_lock;
+extern bench_func bench_sema;
+extern bench_func bench_malloc;
+extern bench_func bench_palloc;
+extern bench_func bench_sleep;
+extern bench_func bench_thread_create;
+
+void bench_report (const char *metric, int64_t value, const char *unit);
+void bench_report_time (const char *metric, int64_t start, int64_t op_cnt);
+
+#endif /* tests/bench/bench.h */
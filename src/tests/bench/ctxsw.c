@@ -0,0 +1,42 @@
+/* Measures the time to switch between two threads that take
+   turns calling thread_yield(). */
+
+#include "tests/bench/bench.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define YIELD_CNT 20000
+
+static thread_func yield_thread;
+
+void
+bench_ctxsw (void)
+{
+  struct semaphore done;
+  int64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  thread_create ("yielder", PRI_DEFAULT, yield_thread, &done);
+
+  /* Let the new thread start before the clock starts. */
+  thread_yield ();
+
+  start = timer_nsecs ();
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  sema_down (&done);
+  bench_report_time ("yield-switch", start, 2 * YIELD_CNT);
+}
+
+/* Yields YIELD_CNT times, then ups DONE. */
+static void
+yield_thread (void *done)
+{
+  int i;
+
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  sema_up (done);
+}
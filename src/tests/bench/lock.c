@@ -0,0 +1,77 @@
+/* Measures lock_acquire() and lock_release() without contention,
+   and with two threads contending for the same lock, so that
+   every acquisition blocks. */
+
+#include "tests/bench/bench.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define UNCONTENDED_CNT 100000
+#define CONTENDED_CNT 10000
+
+/* Shared by the contending threads. */
+struct contend
+  {
+    struct lock lock;           /* The contended lock. */
+    struct semaphore done;      /* Upped by the second thread. */
+  };
+
+static void contend (struct lock *);
+static thread_func contend_thread;
+
+void
+bench_lock (void)
+{
+  struct contend c;
+  int64_t start;
+  int i;
+
+  lock_init (&c.lock);
+  sema_init (&c.done, 0);
+
+  start = timer_nsecs ();
+  for (i = 0; i < UNCONTENDED_CNT; i++)
+    {
+      lock_acquire (&c.lock);
+      lock_release (&c.lock);
+    }
+  bench_report_time ("uncontended", start, UNCONTENDED_CNT);
+
+  thread_create ("contender", PRI_DEFAULT, contend_thread, &c);
+  thread_yield ();
+
+  start = timer_nsecs ();
+  contend (&c.lock);
+  sema_down (&c.done);
+  bench_report_time ("contended", start, 2 * CONTENDED_CNT);
+}
+
+/* Acquires LOCK CONTENDED_CNT times, handing it off to the other
+   thread each time.  Yielding while holding LOCK makes the other
+   thread block trying to acquire it.  Yielding again after
+   releasing it lets the other thread take LOCK before we can
+   re-acquire it, so that our next acquisition blocks in turn. */
+static void
+contend (struct lock *lock)
+{
+  int i;
+
+  for (i = 0; i < CONTENDED_CNT; i++)
+    {
+      lock_acquire (lock);
+      thread_yield ();
+      lock_release (lock);
+      thread_yield ();
+    }
+}
+
+/* Contends for C's lock, then ups C's semaphore. */
+static void
+contend_thread (void *c_)
+{
+  struct contend *c = c_;
+
+  contend (&c->lock);
+  sema_up (&c->done);
+}
@@ -0,0 +1,52 @@
+/* Measures malloc() and free() for each of the kernel's block
+   sizes and for multi-page blocks, both freeing each block right
+   away and allocating a batch of blocks before freeing them. */
+
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+
+#define PAIR_CNT 20000
+#define BATCH_SIZE 64
+#define BATCH_CNT 100
+
+static void bench_size (size_t);
+
+void
+bench_malloc (void)
+{
+  size_t size;
+
+  for (size = 16; size <= 1024; size *= 2)
+    bench_size (size);
+  bench_size (2048);
+  bench_size (8192);
+}
+
+/* Benchmarks malloc() and free() of SIZE-byte blocks. */
+static void
+bench_size (size_t size)
+{
+  static void *blocks[BATCH_SIZE];
+  char metric[32];
+  int64_t start;
+  int i, j;
+
+  start = timer_nsecs ();
+  for (i = 0; i < PAIR_CNT; i++)
+    free (malloc (size));
+  snprintf (metric, sizeof metric, "pair-%zu", size);
+  bench_report_time (metric, start, PAIR_CNT);
+
+  start = timer_nsecs ();
+  for (i = 0; i < BATCH_CNT; i++)
+    {
+      for (j = 0; j < BATCH_SIZE; j++)
+        blocks[j] = malloc (size);
+      for (j = 0; j < BATCH_SIZE; j++)
+        free (blocks[j]);
+    }
+  snprintf (metric, sizeof metric, "batch-%zu", size);
+  bench_report_time (metric, start, BATCH_CNT * BATCH_SIZE);
+}
@@ -0,0 +1,45 @@
+/* Measures page churn through the page allocator: single pages
+   freed right away, batches of pages, and multi-page runs. */
+
+#include "tests/bench/bench.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define PAIR_CNT 20000
+#define BATCH_SIZE 64
+#define BATCH_CNT 100
+#define RUN_PAGES 4
+
+void
+bench_palloc (void)
+{
+  static void *pages[BATCH_SIZE];
+  int64_t start;
+  int i, j;
+
+  start = timer_nsecs ();
+  for (i = 0; i < PAIR_CNT; i++)
+    palloc_free_page (palloc_get_page (PAL_ASSERT));
+  bench_report_time ("pair", start, PAIR_CNT);
+
+  start = timer_nsecs ();
+  for (i = 0; i < BATCH_CNT; i++)
+    {
+      for (j = 0; j < BATCH_SIZE; j++)
+        pages[j] = palloc_get_page (PAL_ASSERT);
+      for (j = 0; j < BATCH_SIZE; j++)
+        palloc_free_page (pages[j]);
+    }
+  bench_report_time ("batch", start, BATCH_CNT * BATCH_SIZE);
+
+  start = timer_nsecs ();
+  for (i = 0; i < PAIR_CNT; i++)
+    palloc_free_multiple (palloc_get_multiple (PAL_ASSERT, RUN_PAGES),
+                          RUN_PAGES);
+  bench_report_time ("run-4", start, PAIR_CNT);
+
+  start = timer_nsecs ();
+  for (i = 0; i < PAIR_CNT / 10; i++)
+    palloc_free_page (palloc_get_page (PAL_ASSERT | PAL_ZERO));
+  bench_report_time ("pair-zero", start, PAIR_CNT / 10);
+}
@@ -0,0 +1,53 @@
+/* Measures the round trip of a semaphore "ping-pong" between two
+   threads, each of which blocks until the other ups its
+   semaphore. */
+
+#include "tests/bench/bench.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ROUND_TRIP_CNT 10000
+
+/* A pair of semaphores. */
+struct ping_pong
+  {
+    struct semaphore ping;      /* Upped by the main thread. */
+    struct semaphore pong;      /* Upped by the other thread. */
+  };
+
+static thread_func pong_thread;
+
+void
+bench_sema (void)
+{
+  struct ping_pong pp;
+  int64_t start;
+  int i;
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  thread_create ("pong", PRI_DEFAULT, pong_thread, &pp);
+
+  start = timer_nsecs ();
+  for (i = 0; i < ROUND_TRIP_CNT; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+  bench_report_time ("ping-pong", start, ROUND_TRIP_CNT);
+}
+
+/* Answers each ping with a pong. */
+static void
+pong_thread (void *pp_)
+{
+  struct ping_pong *pp = pp_;
+  int i;
+
+  for (i = 0; i < ROUND_TRIP_CNT; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+}
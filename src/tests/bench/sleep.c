@@ -0,0 +1,52 @@
+/* Measures how late timer_sleep() wakes up a thread, for a few
+   sleep lengths. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20
+
+static void bench_ticks (int64_t ticks);
+
+void
+bench_sleep (void)
+{
+  bench_ticks (1);
+  bench_ticks (2);
+  bench_ticks (5);
+  bench_ticks (10);
+}
+
+/* Sleeps for TICKS timer ticks SLEEP_CNT times and reports the
+   mean and worst lateness, in microseconds. */
+static void
+bench_ticks (int64_t ticks)
+{
+  int64_t expect = ticks * (1000 * 1000 * 1000 / TIMER_FREQ);
+  int64_t total = 0, worst = 0;
+  char metric[32];
+  int i;
+
+  /* Start on a tick boundary, as every later sleep will. */
+  timer_sleep (1);
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      int64_t start = timer_nsecs ();
+      int64_t late;
+
+      timer_sleep (ticks);
+      late = timer_nsecs () - start - expect;
+      total += late;
+      if (late > worst)
+        worst = late;
+    }
+
+  snprintf (metric, sizeof metric, "late-%"PRId64"-mean", ticks);
+  bench_report (metric, total / SLEEP_CNT / 1000, "us");
+  snprintf (metric, sizeof metric, "late-%"PRId64"-max", ticks);
+  bench_report (metric, worst / 1000, "us");
+}
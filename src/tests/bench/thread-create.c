@@ -0,0 +1,41 @@
+/* Measures how quickly threads can be created, run, and
+   destroyed. */
+
+#include "tests/bench/bench.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Threads are created in batches, so that no more than
+   BATCH_SIZE thread pages are in use at once. */
+#define BATCH_SIZE 32
+#define BATCH_CNT 50
+
+static thread_func exit_thread;
+
+void
+bench_thread_create (void)
+{
+  struct semaphore done;
+  int64_t start;
+  int i, j;
+
+  sema_init (&done, 0);
+
+  start = timer_nsecs ();
+  for (i = 0; i < BATCH_CNT; i++)
+    {
+      for (j = 0; j < BATCH_SIZE; j++)
+        thread_create ("bench", PRI_DEFAULT, exit_thread, &done);
+      for (j = 0; j < BATCH_SIZE; j++)
+        sema_down (&done);
+    }
+  bench_report_time ("create-exit", start, BATCH_CNT * BATCH_SIZE);
+}
+
+/* Ups DONE and exits. */
+static void
+exit_thread (void *done)
+{
+  sema_up (done);
+}
@@ -0,0 +1,102 @@
+/* Timing and reporting for the file system benchmarks.
+
+   Each measurement is bracketed by bench_start() and
+   bench_stop(), which reports the rate of operations and of
+   data transfer, plus how much the buffer cache and the file
+   system device did meanwhile, for example
+
+        bench fs-seq write-4096 2796 kB/s
+        bench fs-seq write-4096-cache-misses 212 blocks */
+
+#include "tests/filesys/bench/bench.h"
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* State at bench_start(). */
+static int64_t start_ns;
+static struct fsstat start_stats;
+
+static void report_rate (const char *metric, long long cnt,
+                         long long scale, int64_t ns, const char *unit);
+static void report_count (const char *metric, const char *counter,
+                          unsigned long long cnt, const char *unit);
+
+/* Starts a measurement. */
+void
+bench_start (void)
+{
+  if (!fsstat (&start_stats))
+    fail ("fsstat failed");
+  start_ns = nsecs ();
+}
+
+/* Ends the measurement of METRIC, for which OP_CNT operations
+   transferred BYTE_CNT bytes, and reports the results. */
+void
+bench_stop (const char *metric, long long op_cnt, long long byte_cnt)
+{
+  int64_t ns = nsecs () - start_ns;
+  struct fsstat s;
+
+  if (!fsstat (&s))
+    fail ("fsstat failed");
+  if (ns <= 0)
+    ns = 1;
+
+  report_rate (metric, op_cnt, 1, ns, "ops/s");
+  if (byte_cnt > 0)
+    report_rate (metric, byte_cnt, 1024, ns, "kB/s");
+  report_count (metric, "cache-hits",
+                s.cache_hits - start_stats.cache_hits, "blocks");
+  report_count (metric, "cache-misses",
+                s.cache_misses - start_stats.cache_misses, "blocks");
+  report_count (metric, "cache-evictions",
+                s.cache_evictions - start_stats.cache_evictions, "blocks");
+  report_count (metric, "cache-read-aheads",
+                s.cache_read_aheads - start_stats.cache_read_aheads,
+                "blocks");
+  report_count (metric, "dev-read",
+                s.dev_reads - start_stats.dev_reads, "sectors");
+  report_count (metric, "dev-written",
+                s.dev_writes - start_stats.dev_writes, "sectors");
+}
+
+/* Creates a file named NAME filled with SIZE bytes of data. */
+void
+bench_make_file (const char *name, size_t size)
+{
+  static char buf[4096];
+  size_t ofs;
+  int fd;
+
+  if (!create (name, 0) || (fd = open (name)) < 0)
+    fail ("create \"%s\" failed", name);
+  for (ofs = 0; ofs < size; ofs += sizeof buf)
+    {
+      size_t n = size - ofs < sizeof buf ? size - ofs : sizeof buf;
+      if (write (fd, buf, n) != (int) n)
+        fail ("write \"%s\" failed", name);
+    }
+  close (fd);
+}
+
+/* Reports CNT / SCALE per second over NS nanoseconds. */
+static void
+report_rate (const char *metric, long long cnt, long long scale,
+             int64_t ns, const char *unit)
+{
+  /* Computed in an order that neither overflows nor loses much
+     precision. */
+  long long rate = cnt * 1000000 / scale * 1000 / ns;
+
+  printf ("bench %s %s %lld %s\n", test_name, metric, rate, unit);
+}
+
+/* Reports CNT, in UNIT, as COUNTER during METRIC. */
+static void
+report_count (const char *metric, const char *counter,
+              unsigned long long cnt, const char *unit)
+{
+  printf ("bench %s %s-%s %llu %s\n", test_name, metric, counter, cnt, unit);
+}
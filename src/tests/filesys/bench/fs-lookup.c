@@ -0,0 +1,52 @@
+/* Measures name lookup in a directory with many entries, both
+   for names that exist and for names that do not. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+#define LOOKUP_CNT 1000
+
+void
+test_main (void)
+{
+  char name[32];
+  int i;
+
+  if (!mkdir ("/big"))
+    fail ("mkdir \"/big\" failed");
+  bench_start ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "/big/file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  bench_stop ("create", FILE_CNT, 0);
+
+  bench_start ();
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "/big/file%lu",
+                random_ulong () % FILE_CNT);
+      if ((fd = open (name)) < 0)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  bench_stop ("lookup-hit", LOOKUP_CNT, 0);
+
+  bench_start ();
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      snprintf (name, sizeof name, "/big/none%d", i);
+      if (open (name) >= 0)
+        fail ("open \"%s\" succeeded", name);
+    }
+  bench_stop ("lookup-miss", LOOKUP_CNT, 0);
+}
@@ -0,0 +1,74 @@
+/* Measures the rate of file creation, opening, and removal in
+   the root directory and in a directory 8 levels deep, where
+   every operation must look up the whole path. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 50
+#define DEPTH 8
+
+static void bench_dir (const char *dir, const char *label);
+
+void
+test_main (void)
+{
+  char dir[64] = "";
+  int i;
+
+  bench_dir ("", "flat");
+
+  for (i = 0; i < DEPTH; i++)
+    {
+      strlcat (dir, "/d", sizeof dir);
+      if (!mkdir (dir))
+        fail ("mkdir \"%s\" failed", dir);
+    }
+  bench_dir (dir, "deep");
+}
+
+/* Creates, opens, and removes FILE_CNT files in DIR, reporting
+   each phase's metrics with LABEL. */
+static void
+bench_dir (const char *dir, const char *label)
+{
+  char name[80], metric[32];
+  int i;
+
+  bench_start ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "%s/f%d", dir, i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  snprintf (metric, sizeof metric, "%s-create", label);
+  bench_stop (metric, FILE_CNT, 0);
+
+  bench_start ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "%s/f%d", dir, i);
+      if ((fd = open (name)) < 0)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  snprintf (metric, sizeof metric, "%s-open", label);
+  bench_stop (metric, FILE_CNT, 0);
+
+  bench_start ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "%s/f%d", dir, i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  snprintf (metric, sizeof metric, "%s-remove", label);
+  bench_stop (metric, FILE_CNT, 0);
+}
@@ -0,0 +1,57 @@
+/* Measures random-offset read and write throughput within a
+   1 MB file at several I/O sizes. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+#define OP_CNT 256
+
+static char buf[4096];
+
+static const size_t io_sizes[] = {512, 4096};
+
+void
+test_main (void)
+{
+  size_t i;
+  int fd;
+
+  bench_make_file ("random", FILE_SIZE);
+  if ((fd = open ("random")) < 0)
+    fail ("open \"random\" failed");
+
+  for (i = 0; i < sizeof io_sizes / sizeof *io_sizes; i++)
+    {
+      size_t size = io_sizes[i];
+      char metric[32];
+      int j;
+
+      bench_start ();
+      for (j = 0; j < OP_CNT; j++)
+        {
+          seek (fd, random_ulong () % (FILE_SIZE / size) * size);
+          if (read (fd, buf, size) != (int) size)
+            fail ("random read failed");
+        }
+      snprintf (metric, sizeof metric, "read-%zu", size);
+      bench_stop (metric, OP_CNT, (long long) OP_CNT * size);
+
+      bench_start ();
+      for (j = 0; j < OP_CNT; j++)
+        {
+          seek (fd, random_ulong () % (FILE_SIZE / size) * size);
+          if (write (fd, buf, size) != (int) size)
+            fail ("random write failed");
+        }
+      snprintf (metric, sizeof metric, "write-%zu", size);
+      bench_stop (metric, OP_CNT, (long long) OP_CNT * size);
+    }
+
+  close (fd);
+  remove ("random");
+}
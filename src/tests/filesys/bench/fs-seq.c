@@ -0,0 +1,50 @@
+/* Measures sequential write and read throughput of a 1 MB file
+   at several I/O sizes. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+
+static char buf[65536];
+
+static const size_t io_sizes[] = {512, 4096, 65536};
+
+void
+test_main (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof io_sizes / sizeof *io_sizes; i++)
+    {
+      size_t size = io_sizes[i];
+      char name[16], metric[32];
+      size_t ofs;
+      int fd;
+
+      snprintf (name, sizeof name, "seq-%zu", size);
+      if (!create (name, 0) || (fd = open (name)) < 0)
+        fail ("create \"%s\" failed", name);
+
+      bench_start ();
+      for (ofs = 0; ofs < FILE_SIZE; ofs += size)
+        if (write (fd, buf, size) != (int) size)
+          fail ("write at offset %zu in \"%s\" failed", ofs, name);
+      snprintf (metric, sizeof metric, "write-%zu", size);
+      bench_stop (metric, FILE_SIZE / size, FILE_SIZE);
+
+      seek (fd, 0);
+      bench_start ();
+      for (ofs = 0; ofs < FILE_SIZE; ofs += size)
+        if (read (fd, buf, size) != (int) size)
+          fail ("read at offset %zu in \"%s\" failed", ofs, name);
+      snprintf (metric, sizeof metric, "read-%zu", size);
+      bench_stop (metric, FILE_SIZE / size, FILE_SIZE);
+
+      close (fd);
+      remove (name);
+    }
+}
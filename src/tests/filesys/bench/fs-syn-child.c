@@ -0,0 +1,47 @@
+/* Child process for fs-syn.
+   Even-numbered children write FILE_SIZE bytes to a file of
+   their own; odd-numbered children read the shared file. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/bench/fs-syn.h"
+#include "tests/lib.h"
+
+const char *test_name = "fs-syn-child";
+
+static char buf[IO_SIZE];
+
+int
+main (int argc, char *argv[])
+{
+  char name[16];
+  int child_idx;
+  size_t ofs;
+  int fd;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  if (child_idx % 2 == 0)
+    {
+      snprintf (name, sizeof name, "syn-%d", child_idx);
+      CHECK (create (name, 0), "create \"%s\"", name);
+    }
+  else
+    snprintf (name, sizeof name, "%s", SHARED_FILE);
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+
+  for (ofs = 0; ofs < FILE_SIZE; ofs += IO_SIZE)
+    if (child_idx % 2 == 0)
+      CHECK (write (fd, buf, IO_SIZE) == IO_SIZE,
+             "write at offset %zu in \"%s\"", ofs, name);
+    else
+      CHECK (read (fd, buf, IO_SIZE) == IO_SIZE,
+             "read at offset %zu in \"%s\"", ofs, name);
+  close (fd);
+
+  return child_idx;
+}
@@ -0,0 +1,25 @@
+/* Measures aggregate throughput of concurrent processes: half
+   of them write files of their own while the other half read a
+   shared file, as in tests/filesys/extended/syn-rw.c. */
+
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/filesys/bench/fs-syn.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+
+  bench_make_file (SHARED_FILE, FILE_SIZE);
+
+  quiet = true;
+  bench_start ();
+  exec_children ("fs-syn-child", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+  bench_stop ("read-write", CHILD_CNT * (FILE_SIZE / IO_SIZE),
+              CHILD_CNT * FILE_SIZE);
+  quiet = false;
+}
@@ -0,0 +1,9 @@
+#ifndef TESTS_FILESYS_BENCH_FS_SYN_H
+#define TESTS_FILESYS_BENCH_FS_SYN_H
+
+#define CHILD_CNT 4
+#define FILE_SIZE (256 * 1024)
+#define IO_SIZE 4096
+#define SHARED_FILE "shared"
+
+#endif /* tests/filesys/bench/fs-syn.h */
@@ -0,0 +1,80 @@
+/* Measures building a tree of directories and files, like the
+   one made by tests/filesys/extended/mk-tree.c, and then looking
+   up every file in it. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Fan-out at each level: /0../3 /0/0../2 /0/0/0../2, with four
+   files in each of the directories at the bottom. */
+#define AT 4
+#define BT 3
+#define CT 3
+#define DT 4
+
+static void do_mkdir (const char *format, ...) PRINTF_FORMAT (1, 2);
+
+void
+test_main (void)
+{
+  char name[32];
+  int a, b, c, d;
+
+  bench_start ();
+  for (a = 0; a < AT; a++)
+    {
+      do_mkdir ("/%d", a);
+      for (b = 0; b < BT; b++)
+        {
+          do_mkdir ("/%d/%d", a, b);
+          for (c = 0; c < CT; c++)
+            do_mkdir ("/%d/%d/%d", a, b, c);
+        }
+    }
+  bench_stop ("mkdir", AT + AT * BT + AT * BT * CT, 0);
+
+  bench_start ();
+  for (a = 0; a < AT; a++)
+    for (b = 0; b < BT; b++)
+      for (c = 0; c < CT; c++)
+        for (d = 0; d < DT; d++)
+          {
+            snprintf (name, sizeof name, "/%d/%d/%d/%d", a, b, c, d);
+            if (!create (name, 0))
+              fail ("create \"%s\" failed", name);
+          }
+  bench_stop ("create", AT * BT * CT * DT, 0);
+
+  bench_start ();
+  for (a = 0; a < AT; a++)
+    for (b = 0; b < BT; b++)
+      for (c = 0; c < CT; c++)
+        for (d = 0; d < DT; d++)
+          {
+            int fd;
+
+            snprintf (name, sizeof name, "/%d/%d/%d/%d", a, b, c, d);
+            if ((fd = open (name)) < 0)
+              fail ("open \"%s\" failed", name);
+            close (fd);
+          }
+  bench_stop ("lookup", AT * BT * CT * DT, 0);
+}
+
+/* Creates the directory named by FORMAT. */
+static void
+do_mkdir (const char *format, ...)
+{
+  char dir[32];
+  va_list args;
+
+  va_start (args, format);
+  vsnprintf (dir, sizeof dir, format, args);
+  va_end (args);
+
+  if (!mkdir (dir))
+    fail ("mkdir \"%s\" failed", dir);
+}
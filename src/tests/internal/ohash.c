@@ -0,0 +1,193 @@
+/* Test program for lib/kernel/ohash.c.
+
+   Inserts, finds, replaces, and deletes random sets of values,
+   both with a good hash function and with one that puts many
+   values in the same home slot, and checks the table's probing
+   invariant after every step.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a hash table that we will
+   test. */
+#define MAX_SIZE 300
+
+/* A hash table element. */
+struct value
+  {
+    struct ohash_elem elem;     /* Hash element. */
+    int value;                  /* Item value. */
+  };
+
+static void shuffle (struct value *[], size_t);
+static unsigned value_hash (const struct ohash_elem *, void *);
+static bool value_equal (const struct ohash_elem *, const struct ohash_elem *,
+                         void *);
+static void verify_table (struct ohash *, struct value *[], int size);
+static void test_size (int size, bool *weak);
+
+/* Test the open-addressing hash table implementation. */
+void
+test (void)
+{
+  static bool weak[] = {false, true};
+  int size;
+
+  printf ("testing various size hash tables:");
+  for (size = 0; size < MAX_SIZE; size += 1 + size / 8)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 4; repeat++)
+        {
+          test_size (size, &weak[0]);
+          test_size (size, &weak[1]);
+        }
+    }
+
+  printf (" done\n");
+  printf ("ohash: PASS\n");
+}
+
+/* Tests a hash table of SIZE values, with a weak hash function
+   if *WEAK is true. */
+static void
+test_size (int size, bool *weak)
+{
+  static struct value values[MAX_SIZE], dups[MAX_SIZE];
+  static struct value *order[MAX_SIZE];
+  struct ohash h;
+  int i;
+
+  ASSERT (ohash_init (&h, value_hash, value_equal, weak));
+
+  /* Insert values in random order. */
+  for (i = 0; i < size; i++)
+    {
+      values[i].value = dups[i].value = i;
+      order[i] = &values[i];
+    }
+  shuffle (order, size);
+  for (i = 0; i < size; i++)
+    ASSERT (ohash_insert (&h, &order[i]->elem) == NULL);
+  verify_table (&h, order, size);
+
+  /* Inserting an equal value must fail; replacing must succeed. */
+  for (i = 0; i < size; i++)
+    {
+      ASSERT (ohash_insert (&h, &dups[i].elem) == &values[i].elem);
+      ASSERT (ohash_replace (&h, &dups[i].elem) == &values[i].elem);
+      ASSERT (ohash_find (&h, &values[i].elem) == &dups[i].elem);
+      order[i] = &dups[i];
+    }
+  verify_table (&h, order, size);
+
+  /* Delete half the values by key and the rest directly, in
+     random order, checking the table as it shrinks. */
+  shuffle (order, size);
+  for (i = 0; i < size; i++)
+    {
+      if (i % 2)
+        {
+          ASSERT (ohash_delete (&h, &order[i]->elem) == &order[i]->elem);
+        }
+      else
+        ohash_remove (&h, &order[i]->elem);
+      ASSERT (ohash_find (&h, &order[i]->elem) == NULL);
+      if (i % 16 == 0 || i == size - 1)
+        verify_table (&h, order + i + 1, size - i - 1);
+    }
+  ASSERT (ohash_empty (&h));
+
+  ohash_destroy (&h, NULL);
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns a hash of value E.  If *WEAK is true, many values get
+   the same hash, to produce long probe sequences. */
+static unsigned
+value_hash (const struct ohash_elem *e, void *weak_)
+{
+  const struct value *v = ohash_entry (e, struct value, elem);
+  bool *weak = weak_;
+
+  return *weak ? (unsigned) v->value / 8 : hash_int (v->value);
+}
+
+/* Returns true if values A and B are equal. */
+static bool
+value_equal (const struct ohash_elem *a_, const struct ohash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct value *a = ohash_entry (a_, struct value, elem);
+  const struct value *b = ohash_entry (b_, struct value, elem);
+
+  return a->value == b->value;
+}
+
+/* Verifies that H contains exactly the SIZE values in VALUES,
+   and that every element can be reached from its home slot
+   without passing an empty slot or an element closer to its own
+   home. */
+static void
+verify_table (struct ohash *h, struct value *values[], int size)
+{
+  struct ohash_iterator it;
+  size_t mask = h->slot_cnt - 1;
+  size_t slot;
+  int i, cnt;
+
+  ASSERT (ohash_size (h) == (size_t) size);
+  ASSERT (h->elem_cnt < h->slot_cnt);
+  for (i = 0; i < size; i++)
+    ASSERT (ohash_find (h, &values[i]->elem) == &values[i]->elem);
+
+  cnt = 0;
+  ohash_first (&it, h);
+  while (ohash_next (&it))
+    cnt++;
+  ASSERT (cnt == size);
+
+  for (slot = 0; slot < h->slot_cnt; slot++)
+    {
+      const struct ohash_slot *s = &h->slots[slot];
+      size_t distance, d;
+
+      if (s->elem == NULL)
+        continue;
+      ASSERT (s->hash == s->elem->hash);
+      distance = (slot - s->hash) & mask;
+      for (d = 1; d <= distance; d++)
+        {
+          size_t prev = (slot - d) & mask;
+          const struct ohash_slot *p = &h->slots[prev];
+
+          ASSERT (p->elem != NULL);
+          ASSERT (((prev - p->hash) & mask) >= distance - d);
+        }
+    }
+}
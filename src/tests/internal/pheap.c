@@ -0,0 +1,152 @@
+/* Test program for lib/kernel/pheap.c.
+
+   Fills heaps with random values, decreases and removes some of
+   them, and then drains the heaps, checking the heap order
+   along the way.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <pheap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 256
+
+/* A heap element. */
+struct value
+  {
+    struct pheap_elem elem;     /* Heap element. */
+    int value;                  /* Item value, the sort key. */
+    bool in_heap;               /* Currently in the heap? */
+  };
+
+static bool value_less (const struct pheap_elem *, const struct pheap_elem *,
+                        void *);
+static size_t verify_subtree (const struct pheap_elem *);
+static void verify_heap (struct pheap *);
+
+/* Test the pairing heap implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size += 1 + size / 8)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          struct pheap heap;
+          int i, prev, cnt;
+
+          /* Insert random values, with some duplicates. */
+          pheap_init (&heap, value_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = random_ulong () % (size + 1);
+              values[i].in_heap = true;
+              pheap_insert (&heap, &values[i].elem);
+            }
+          verify_heap (&heap);
+
+          /* Pop the least element once, so that the heap has some
+             depth, then decrease a third of the keys and remove
+             another third of the elements. */
+          if (size > 0)
+            pheap_entry (pheap_pop_min (&heap), struct value, elem)
+              ->in_heap = false;
+          for (i = 0; i < size; i++)
+            if (values[i].in_heap)
+              switch (random_ulong () % 3)
+                {
+                case 0:
+                  values[i].value -= random_ulong () % (size + 1);
+                  pheap_decrease (&heap, &values[i].elem);
+                  break;
+                case 1:
+                  pheap_remove (&heap, &values[i].elem);
+                  values[i].in_heap = false;
+                  break;
+                }
+          verify_heap (&heap);
+
+          /* Drain the heap in order. */
+          cnt = 0;
+          for (i = 0; i < size; i++)
+            cnt += values[i].in_heap;
+          ASSERT (pheap_size (&heap) == (size_t) cnt);
+          prev = -MAX_SIZE;
+          while (!pheap_empty (&heap))
+            {
+              struct value *v = pheap_entry (pheap_pop_min (&heap),
+                                             struct value, elem);
+              ASSERT (v->in_heap);
+              ASSERT (v->value >= prev);
+              v->in_heap = false;
+              prev = v->value;
+              cnt--;
+            }
+          ASSERT (cnt == 0);
+          ASSERT (pheap_min (&heap) == NULL);
+        }
+    }
+
+  printf (" done\n");
+  printf ("pheap: PASS\n");
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = pheap_entry (a_, struct value, elem);
+  const struct value *b = pheap_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies that no element in the subtree rooted at E is less
+   than its parent and that the links are consistent.  Returns
+   the number of elements in the subtree. */
+static size_t
+verify_subtree (const struct pheap_elem *e)
+{
+  const struct pheap_elem *c, *prev;
+  size_t cnt = 1;
+
+  ASSERT (pheap_entry (e, struct value, elem)->in_heap);
+  for (prev = e, c = e->child; c != NULL; prev = c, c = c->next)
+    {
+      ASSERT (c->prev == prev);
+      ASSERT (!value_less (c, e, NULL));
+      cnt += verify_subtree (c);
+    }
+  return cnt;
+}
+
+/* Verifies the structure of HEAP. */
+static void
+verify_heap (struct pheap *heap)
+{
+  if (heap->root == NULL)
+    {
+      ASSERT (pheap_size (heap) == 0);
+    }
+  else
+    {
+      ASSERT (heap->root->prev == NULL && heap->root->next == NULL);
+      ASSERT (verify_subtree (heap->root) == pheap_size (heap));
+    }
+}
@@ -0,0 +1,202 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Builds trees of random values, including duplicates, and
+   removes their elements in random order, checking the
+   red-black properties, the in-order sequence, and searches
+   along the way.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a tree that we will test. */
+#define MAX_SIZE 256
+
+/* A tree element. */
+struct value
+  {
+    struct rb_elem elem;        /* Tree element. */
+    int value;                  /* Item value, the sort key. */
+    int seq;                    /* Insertion order. */
+    bool in_tree;               /* Currently in the tree? */
+  };
+
+static void shuffle (struct value *[], size_t);
+static bool value_less (const struct rb_elem *, const struct rb_elem *,
+                        void *);
+static int verify_subtree (const struct rb_elem *,
+                           const struct rb_elem *parent);
+static void verify_tree (struct rb_tree *, struct value[], int size);
+
+/* Test the red-black tree implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size += 1 + size / 8)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          static struct value *order[MAX_SIZE];
+          struct rb_tree tree;
+          int i;
+
+          /* Insert values 0...SIZE/2, each twice, in random
+             order. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i / 2;
+              values[i].in_tree = false;
+              order[i] = &values[i];
+            }
+          shuffle (order, size);
+          rb_init (&tree, value_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              order[i]->seq = i;
+              order[i]->in_tree = true;
+              rb_insert (&tree, &order[i]->elem);
+            }
+          verify_tree (&tree, values, size);
+
+          /* Remove the values in random order. */
+          shuffle (order, size);
+          for (i = 0; i < size; i++)
+            {
+              rb_remove (&tree, &order[i]->elem);
+              order[i]->in_tree = false;
+              if (i % 8 == 0 || i == size - 1)
+                verify_tree (&tree, values, size);
+            }
+          ASSERT (rb_empty (&tree));
+          ASSERT (rb_min (&tree) == NULL);
+        }
+    }
+
+  printf (" done\n");
+  printf ("rbtree: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = rb_entry (a_, struct value, elem);
+  const struct value *b = rb_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies the red-black properties of the subtree rooted at E,
+   whose parent should be PARENT, and returns its black height. */
+static int
+verify_subtree (const struct rb_elem *e, const struct rb_elem *parent)
+{
+  int left, right;
+
+  if (e == NULL)
+    return 1;
+
+  ASSERT (e->parent == parent);
+  ASSERT (!e->red
+          || ((e->left == NULL || !e->left->red)
+              && (e->right == NULL || !e->right->red)));
+
+  left = verify_subtree (e->left, e);
+  right = verify_subtree (e->right, e);
+  ASSERT (left == right);
+  return left + !e->red;
+}
+
+/* Verifies that TREE holds exactly the elements of the SIZE
+   VALUES marked as in the tree, in order, and that searches find
+   them. */
+static void
+verify_tree (struct rb_tree *tree, struct value values[], int size)
+{
+  const struct value *prev = NULL;
+  struct rb_elem *e;
+  int i, cnt;
+
+  ASSERT (tree->root == NULL || !tree->root->red);
+  verify_subtree (tree->root, NULL);
+
+  /* Forward traversal is sorted, with equal values in insertion
+     order. */
+  cnt = 0;
+  for (e = rb_min (tree); e != NULL; e = rb_next (e))
+    {
+      const struct value *v = rb_entry (e, struct value, elem);
+
+      ASSERT (v->in_tree);
+      ASSERT (prev == NULL
+              || prev->value < v->value
+              || (prev->value == v->value && prev->seq < v->seq));
+      prev = v;
+      cnt++;
+    }
+  ASSERT ((size_t) cnt == rb_size (tree));
+  ASSERT (prev == NULL || &prev->elem == rb_max (tree));
+
+  /* Backward traversal visits the same number of elements. */
+  for (e = rb_max (tree); e != NULL; e = rb_prev (e))
+    cnt--;
+  ASSERT (cnt == 0);
+
+  /* Every value in the tree can be found, and each search lands
+     on the first element with that value. */
+  for (i = 0; i < size; i++)
+    {
+      struct value key;
+      struct rb_elem *found, *upper;
+
+      key.value = values[i].value;
+      found = rb_find (tree, &key.elem);
+      upper = rb_upper_bound (tree, &key.elem);
+      if (found == NULL)
+        {
+          ASSERT (!values[i].in_tree);
+          ASSERT (upper == rb_lower_bound (tree, &key.elem));
+          continue;
+        }
+
+      ASSERT (rb_entry (found, struct value, elem)->value == key.value);
+      ASSERT (rb_prev (found) == NULL
+              || rb_entry (rb_prev (found), struct value, elem)->value
+                 < key.value);
+      ASSERT (upper == NULL
+              || rb_entry (upper, struct value, elem)->value > key.value);
+      ASSERT (rb_entry (upper != NULL ? rb_prev (upper) : rb_max (tree),
+                        struct value, elem)->value == key.value);
+    }
+}
@@ -0,0 +1,444 @@
+/* Differential test program for the string functions in
+   lib/string.c.
+
+   The functions in lib/string.c scan and copy a word at a time
+   and use character sets, which makes them more complicated than
+   the byte-at-a-time loops they replaced.  This test compares
+   them against those simple loops, kept here as reference
+   versions, on random strings and blocks of memory at every
+   alignment, including memmove() between blocks that overlap in
+   either direction.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Maximum length of a string that we will test. */
+#define MAX_LEN 72
+
+/* Size of the buffers for testing the memory functions: room for
+   MAX_LEN bytes at any alignment and overlap that we test, plus
+   some bytes around them that must not change. */
+#define MEM_BUF_SIZE (MAX_LEN + 48)
+
+/* Number of random strings to test at each length and
+   alignment. */
+#define REPEAT 4
+
+/* Characters that random strings are made of.  Few enough that
+   searches often succeed, and including bytes with the high bit
+   set, which trip up careless zero-byte tests. */
+static const char alphabet[] = "ab/ \xff\x80\x01";
+
+static char *ref_strchr (const char *, int);
+static char *ref_strrchr (const char *, int);
+static size_t ref_strlen (const char *);
+static size_t ref_strcspn (const char *, const char *);
+static size_t ref_strspn (const char *, const char *);
+static char *ref_strtok_r (char *, const char *, char **);
+static void *ref_memcpy (void *, const void *, size_t);
+static void *ref_memmove (void *, const void *, size_t);
+static int ref_memcmp (const void *, const void *, size_t);
+static void *ref_memchr (const void *, int, size_t);
+static void *ref_memset (void *, int, size_t);
+
+static void random_string (char *, size_t length);
+static void test_string (const char *);
+static void test_strtok_r (const char *, const char *delimiters);
+static void test_strlcpy (const char *);
+static void random_block (uint8_t *, size_t size);
+static void test_memory (size_t length, size_t dst_align, size_t src_align);
+
+/* Compare string functions against reference versions. */
+void
+test (void)
+{
+  static const char *delimiter_sets[] = {"", "/", " /", "a\xff", "ab/ "};
+  size_t length;
+
+  printf ("testing various length strings:");
+  for (length = 0; length <= MAX_LEN; length++)
+    {
+      size_t align;
+
+      printf (" %zu", length);
+      for (align = 0; align < 8; align++)
+        {
+          int repeat;
+
+          for (repeat = 0; repeat < REPEAT; repeat++)
+            {
+              static char buf[MAX_LEN + 16];
+              char *s = buf + align;
+              size_t i;
+
+              random_string (s, length);
+              test_string (s);
+              test_strlcpy (s);
+              for (i = 0; i < sizeof delimiter_sets / sizeof *delimiter_sets;
+                   i++)
+                test_strtok_r (s, delimiter_sets[i]);
+            }
+        }
+    }
+
+  printf (" done\n");
+
+  printf ("testing various length memory blocks:");
+  for (length = 0; length <= MAX_LEN; length++)
+    {
+      size_t dst_align, src_align;
+
+      printf (" %zu", length);
+      for (dst_align = 0; dst_align < 8; dst_align++)
+        for (src_align = 0; src_align < 8; src_align++)
+          test_memory (length, dst_align, src_align);
+    }
+
+  printf (" done\n");
+  printf ("string: PASS\n");
+}
+
+/* Stores a random null-terminated string of LENGTH characters
+   from ALPHABET in S. */
+static void
+random_string (char *s, size_t length)
+{
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    s[i] = alphabet[random_ulong () % (sizeof alphabet - 1)];
+  s[length] = '\0';
+}
+
+/* Checks the search functions on S. */
+static void
+test_string (const char *s)
+{
+  static const char *stop_sets[] = {"", "a", "\xff", "b/", " \x80\x01"};
+  const char *c;
+  size_t i;
+
+  ASSERT (strlen (s) == ref_strlen (s));
+  for (c = alphabet; ; c++)
+    {
+      ASSERT (strchr (s, *c) == ref_strchr (s, *c));
+      ASSERT (strrchr (s, *c) == ref_strrchr (s, *c));
+      if (*c == '\0')
+        break;
+    }
+  ASSERT (strchr (s, 'z') == NULL);
+  ASSERT (strrchr (s, 'z') == NULL);
+
+  for (i = 0; i < sizeof stop_sets / sizeof *stop_sets; i++)
+    {
+      size_t length = ref_strcspn (s, stop_sets[i]);
+
+      ASSERT (strcspn (s, stop_sets[i]) == length);
+      ASSERT (strpbrk (s, stop_sets[i])
+              == (s[length] != '\0' ? s + length : NULL));
+      ASSERT (strspn (s, stop_sets[i]) == ref_strspn (s, stop_sets[i]));
+    }
+}
+
+/* Checks strtok_r() on S, split at DELIMITERS. */
+static void
+test_strtok_r (const char *s, const char *delimiters)
+{
+  char a[MAX_LEN + 1], b[MAX_LEN + 1];
+  char *a_save, *b_save;
+  char *a_token, *b_token;
+
+  strlcpy (a, s, sizeof a);
+  strlcpy (b, s, sizeof b);
+  a_token = strtok_r (a, delimiters, &a_save);
+  b_token = ref_strtok_r (b, delimiters, &b_save);
+  for (;;)
+    {
+      ASSERT ((a_token == NULL) == (b_token == NULL));
+      if (a_token == NULL)
+        break;
+      ASSERT (a_token - a == b_token - b);
+      ASSERT (a_save - a == b_save - b);
+      a_token = strtok_r (NULL, delimiters, &a_save);
+      b_token = ref_strtok_r (NULL, delimiters, &b_save);
+    }
+  ASSERT (!memcmp (a, b, strlen (s) + 1));
+}
+
+/* Checks strlcpy() from S into buffers of every size. */
+static void
+test_strlcpy (const char *s)
+{
+  size_t length = ref_strlen (s);
+  size_t size;
+
+  for (size = 0; size <= length + 2; size++)
+    {
+      char buf[MAX_LEN + 3];
+      size_t copied = size > 0 ? (size - 1 < length ? size - 1 : length) : 0;
+
+      memset (buf, 'x', sizeof buf);
+      ASSERT (strlcpy (buf, s, size) == length);
+      ASSERT (!memcmp (buf, s, copied));
+      if (size > 0)
+        {
+          ASSERT (buf[copied] == '\0');
+        }
+      ASSERT (buf[size > 0 ? copied + 1 : 0] == 'x');
+    }
+}
+
+/* Fills the SIZE bytes at P with random characters from
+   ALPHABET, including its null terminator. */
+static void
+random_block (uint8_t *p, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    p[i] = alphabet[random_ulong () % sizeof alphabet];
+}
+
+/* Returns -1, 0, or 1 according to the sign of X. */
+static int
+sign (int x)
+{
+  return (x > 0) - (x < 0);
+}
+
+/* Checks the memory functions on blocks of LENGTH bytes whose
+   destination and source are DST_ALIGN and SRC_ALIGN bytes past
+   an 8-byte boundary, respectively. */
+static void
+test_memory (size_t length, size_t dst_align, size_t src_align)
+{
+  static const int shifts[] = {-16, -8, 0, 8, 16};
+  static uint8_t src[MEM_BUF_SIZE] __attribute__ ((aligned (8)));
+  static uint8_t a[MEM_BUF_SIZE] __attribute__ ((aligned (8)));
+  static uint8_t b[MEM_BUF_SIZE] __attribute__ ((aligned (8)));
+  const uint8_t *s = src + 16 + src_align;
+  size_t ofs = 16 + dst_align;
+  const char *c;
+  size_t i;
+
+  random_block (src, sizeof src);
+  random_block (a, sizeof a);
+  ref_memcpy (b, a, sizeof b);
+
+  /* memcpy() between separate blocks. */
+  ASSERT (memcpy (a + ofs, s, length) == a + ofs);
+  ref_memcpy (b + ofs, s, length);
+  ASSERT (!ref_memcmp (a, b, sizeof a));
+
+  /* memmove() within one block, with the destination before,
+     at, and after the source. */
+  for (i = 0; i < sizeof shifts / sizeof *shifts; i++)
+    {
+      size_t from = 16 + src_align;
+      size_t to = 16 + dst_align + shifts[i];
+
+      ASSERT (memmove (a + to, a + from, length) == a + to);
+      ref_memmove (b + to, b + from, length);
+      ASSERT (!ref_memcmp (a, b, sizeof a));
+    }
+
+  /* memset(), with a byte that has the high bit set and with
+     null bytes. */
+  ASSERT (memset (a + ofs, 0xa5, length) == a + ofs);
+  ref_memset (b + ofs, 0xa5, length);
+  ASSERT (!ref_memcmp (a, b, sizeof a));
+  memset (a + ofs, 0, length);
+  ref_memset (b + ofs, 0, length);
+  ASSERT (!ref_memcmp (a, b, sizeof a));
+
+  /* memcmp() on equal blocks, then on blocks that differ in the
+     first, last, or a random byte. */
+  ref_memcpy (a + ofs, s, length);
+  ASSERT (memcmp (a + ofs, s, length) == 0);
+  if (length > 0)
+    {
+      size_t diffs[3];
+
+      diffs[0] = 0;
+      diffs[1] = length - 1;
+      diffs[2] = random_ulong () % length;
+      for (i = 0; i < sizeof diffs / sizeof *diffs; i++)
+        {
+          uint8_t *p = a + ofs + diffs[i];
+          uint8_t old = *p;
+
+          *p ^= 1 << random_ulong () % 8;
+          ASSERT (sign (memcmp (a + ofs, s, length))
+                  == sign (ref_memcmp (a + ofs, s, length)));
+          ASSERT (sign (memcmp (s, a + ofs, length))
+                  == -sign (ref_memcmp (a + ofs, s, length)));
+          *p = old;
+        }
+    }
+
+  /* memchr() for every character in ALPHABET and one that is
+     never there. */
+  for (c = alphabet; c < alphabet + sizeof alphabet; c++)
+    ASSERT (memchr (s, *c, length) == ref_memchr (s, *c, length));
+  ASSERT (memchr (s, 'z', length) == NULL);
+}
+
+/* Reference versions. */
+
+static char *
+ref_strchr (const char *string, int c_)
+{
+  char c = c_;
+
+  for (;;)
+    if (*string == c)
+      return (char *) string;
+    else if (*string == '\0')
+      return NULL;
+    else
+      string++;
+}
+
+static char *
+ref_strrchr (const char *string, int c_)
+{
+  char c = c_;
+  const char *p = NULL;
+
+  for (; *string != '\0'; string++)
+    if (*string == c)
+      p = string;
+  return (char *) (c == '\0' ? string : p);
+}
+
+static size_t
+ref_strlen (const char *string)
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
+
+static size_t
+ref_strcspn (const char *string, const char *stop)
+{
+  size_t length;
+
+  for (length = 0; string[length] != '\0'; length++)
+    if (ref_strchr (stop, string[length]) != NULL)
+      break;
+  return length;
+}
+
+static size_t
+ref_strspn (const char *string, const char *skip)
+{
+  size_t length;
+
+  for (length = 0; string[length] != '\0'; length++)
+    if (ref_strchr (skip, string[length]) == NULL)
+      break;
+  return length;
+}
+
+static char *
+ref_strtok_r (char *s, const char *delimiters, char **save_ptr)
+{
+  char *token;
+
+  if (s == NULL)
+    s = *save_ptr;
+
+  while (ref_strchr (delimiters, *s) != NULL)
+    {
+      if (*s == '\0')
+        {
+          *save_ptr = s;
+          return NULL;
+        }
+      s++;
+    }
+
+  token = s;
+  while (ref_strchr (delimiters, *s) == NULL)
+    s++;
+  if (*s != '\0')
+    {
+      *s = '\0';
+      *save_ptr = s + 1;
+    }
+  else
+    *save_ptr = s;
+  return token;
+}
+
+static void *
+ref_memcpy (void *dst_, const void *src_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+static void *
+ref_memmove (void *dst_, const void *src_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+
+  if (dst < src)
+    while (size-- > 0)
+      *dst++ = *src++;
+  else
+    while (size-- > 0)
+      dst[size] = src[size];
+  return dst_;
+}
+
+static int
+ref_memcmp (const void *a_, const void *b_, size_t size)
+{
+  const uint8_t *a = a_;
+  const uint8_t *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static void *
+ref_memchr (const void *block_, int ch_, size_t size)
+{
+  const uint8_t *block = block_;
+  uint8_t ch = ch_;
+
+  for (; size-- > 0; block++)
+    if (*block == ch)
+      return (void *) block;
+  return NULL;
+}
+
+static void *
+ref_memset (void *dst_, int value, size_t size)
+{
+  uint8_t *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
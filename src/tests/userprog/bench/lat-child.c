@@ -0,0 +1,9 @@
+/* Child process for lat-exec and lat-fanout.
+   Exits at once, so that its parent measures nothing but the
+   cost of process creation and teardown. */
+
+int
+main (void)
+{
+  return 0;
+}
@@ -0,0 +1,31 @@
+/* Measures the round trip of starting a child process that exits
+   at once and waiting for it. */
+
+#include <syscall.h>
+#include "tests/userprog/bench/latency.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Process creation is slow, so take fewer samples. */
+#define EXEC_CNT 100
+
+static int64_t samples[EXEC_CNT];
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < EXEC_CNT; i++)
+    {
+      int64_t start = nsecs ();
+      pid_t pid = exec ("lat-child");
+
+      if (pid == PID_ERROR)
+        fail ("exec \"lat-child\" failed");
+      if (wait (pid) != 0)
+        fail ("wait for \"lat-child\" failed");
+      samples[i] = nsecs () - start;
+    }
+  latency_report ("exec-wait", samples, EXEC_CNT);
+}
@@ -0,0 +1,49 @@
+/* Measures starting several child processes at once and waiting
+   for all of them, as in multi-child-fd, for a few numbers of
+   children. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/bench/latency.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUND_CNT 20
+#define MAX_CHILDREN 16
+
+static void fan_out (int child_cnt);
+
+void
+test_main (void)
+{
+  fan_out (2);
+  fan_out (4);
+  fan_out (8);
+  fan_out (MAX_CHILDREN);
+}
+
+/* Starts CHILD_CNT children and waits for them, ROUND_CNT
+   times, and reports the time per round. */
+static void
+fan_out (int child_cnt)
+{
+  static int64_t samples[ROUND_CNT];
+  pid_t pids[MAX_CHILDREN];
+  char metric[32];
+  int i, j;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      int64_t start = nsecs ();
+
+      for (j = 0; j < child_cnt; j++)
+        if ((pids[j] = exec ("lat-child")) == PID_ERROR)
+          fail ("exec child %d of %d failed", j + 1, child_cnt);
+      for (j = 0; j < child_cnt; j++)
+        if (wait (pids[j]) != 0)
+          fail ("wait for child %d of %d failed", j + 1, child_cnt);
+      samples[i] = nsecs () - start;
+    }
+  snprintf (metric, sizeof metric, "fan-out-%d", child_cnt);
+  latency_report (metric, samples, ROUND_CNT);
+}
@@ -0,0 +1,29 @@
+/* Measures the latency of opening and closing a file. */
+
+#include <syscall.h>
+#include "tests/userprog/bench/latency.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int64_t samples[SAMPLE_CNT];
+
+void
+test_main (void)
+{
+  int i;
+
+  if (!create ("data", 0))
+    fail ("create \"data\" failed");
+
+  for (i = 0; i < SAMPLE_CNT; i++)
+    {
+      int64_t start = nsecs ();
+      int fd = open ("data");
+
+      if (fd < 0)
+        fail ("open \"data\" failed");
+      close (fd);
+      samples[i] = nsecs () - start;
+    }
+  latency_report ("open-close", samples, SAMPLE_CNT);
+}
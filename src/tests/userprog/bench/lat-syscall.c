@@ -0,0 +1,58 @@
+/* Measures the latency of a null system call, tell() on an open
+   file, and of a 1-byte read() that hits in the buffer cache.
+   These calls are too quick to time one by one, so each sample
+   times a batch of calls and divides.  The cost of nsecs()
+   itself is reported too, as "clock". */
+
+#include <syscall.h>
+#include "tests/userprog/bench/latency.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BATCH_SIZE 16
+
+static int64_t samples[SAMPLE_CNT];
+
+void
+test_main (void)
+{
+  char buf[BATCH_SIZE];
+  int fd;
+  int i, j;
+
+  for (i = 0; i < SAMPLE_CNT; i++)
+    {
+      int64_t start = nsecs ();
+      for (j = 0; j < BATCH_SIZE; j++)
+        nsecs ();
+      samples[i] = (nsecs () - start) / (BATCH_SIZE + 1);
+    }
+  latency_report ("clock", samples, SAMPLE_CNT);
+
+  if (!create ("data", BATCH_SIZE) || (fd = open ("data")) < 0)
+    fail ("create \"data\" failed");
+
+  for (i = 0; i < SAMPLE_CNT; i++)
+    {
+      int64_t start = nsecs ();
+      for (j = 0; j < BATCH_SIZE; j++)
+        tell (fd);
+      samples[i] = (nsecs () - start) / BATCH_SIZE;
+    }
+  latency_report ("null", samples, SAMPLE_CNT);
+
+  for (i = 0; i < SAMPLE_CNT; i++)
+    {
+      int64_t start;
+
+      seek (fd, 0);
+      start = nsecs ();
+      for (j = 0; j < BATCH_SIZE; j++)
+        if (read (fd, buf + j, 1) != 1)
+          fail ("read failed");
+      samples[i] = (nsecs () - start) / BATCH_SIZE;
+    }
+  latency_report ("read-1", samples, SAMPLE_CNT);
+
+  close (fd);
+}
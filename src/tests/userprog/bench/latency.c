@@ -0,0 +1,61 @@
+/* Reporting for the latency benchmarks.
+
+   Each benchmark times an operation many times with nsecs() and
+   passes the samples to latency_report(), which reports their
+   min, p50, p90, p99, max, and mean as metrics named after the
+   operation, for example
+
+        bench lat-syscall null-p50 412 ns
+
+   Percentiles show what a mean hides: the odd sample that took
+   a timer interrupt or a disk access. */
+
+#include "tests/userprog/bench/latency.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "tests/lib.h"
+
+static int compare_samples (const void *, const void *);
+static void report (const char *metric, const char *statistic,
+                    int64_t value);
+
+/* Sorts the CNT SAMPLES of METRIC, in nanoseconds, and reports
+   their distribution. */
+void
+latency_report (const char *metric, int64_t samples[], size_t cnt)
+{
+  int64_t sum = 0;
+  size_t i;
+
+  if (cnt == 0)
+    fail ("no samples for %s", metric);
+
+  qsort (samples, cnt, sizeof *samples, compare_samples);
+  for (i = 0; i < cnt; i++)
+    sum += samples[i];
+
+  report (metric, "min", samples[0]);
+  report (metric, "p50", samples[cnt * 50 / 100]);
+  report (metric, "p90", samples[cnt * 90 / 100]);
+  report (metric, "p99", samples[cnt * 99 / 100]);
+  report (metric, "max", samples[cnt - 1]);
+  report (metric, "mean", sum / (int64_t) cnt);
+}
+
+/* Compares the samples that A_ and B_ point to. */
+static int
+compare_samples (const void *a_, const void *b_)
+{
+  const int64_t *a = a_;
+  const int64_t *b = b_;
+
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Reports VALUE as STATISTIC of METRIC. */
+static void
+report (const char *metric, const char *statistic, int64_t value)
+{
+  printf ("bench %s %s-%s %lld ns\n",
+          test_name, metric, statistic, (long long) value);
+}
@@ -0,0 +1,12 @@
+#ifndef TESTS_USERPROG_BENCH_LATENCY_H
+#define TESTS_USERPROG_BENCH_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of samples taken of each operation. */
+#define SAMPLE_CNT 1000
+
+void latency_report (const char *metric, int64_t samples[], size_t cnt);
+
+#endif /* tests/userprog/bench/latency.h */
@@ -0,0 +1,92 @@
+/* Runs coroutines that yield in round-robin order, then a
+   producer and a consumer that pass values through a bounded
+   buffer, waiting for each other on wait queues. */
+
+#include <coro.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CORO_CNT 50
+#define ROUND_CNT 3
+#define BUF_SIZE 4
+#define ITEM_CNT 1000
+
+/* Round-robin test. */
+static int order[CORO_CNT * ROUND_CNT];
+static int order_cnt;
+
+/* Bounded buffer. */
+static int buf[BUF_SIZE];
+static int head, tail;
+static struct coro_queue not_empty, not_full;
+static int sum;
+
+/* Records coroutine number AUX once per round. */
+static void
+round_robin (void *aux)
+{
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      order[order_cnt++] = (int) aux;
+      coro_yield ();
+    }
+}
+
+/* Puts ITEM_CNT values into the buffer. */
+static void
+producer (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 1; i <= ITEM_CNT; i++)
+    {
+      while (head - tail == BUF_SIZE)
+        coro_wait (&not_full);
+      buf[head++ % BUF_SIZE] = i;
+      coro_wake (&not_empty);
+    }
+}
+
+/* Takes ITEM_CNT values out of the buffer and adds them up. */
+static void
+consumer (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 1; i <= ITEM_CNT; i++)
+    {
+      while (head == tail)
+        coro_wait (&not_empty);
+      sum += buf[tail++ % BUF_SIZE];
+      coro_wake (&not_full);
+    }
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  msg ("create %d coroutines", CORO_CNT);
+  for (i = 0; i < CORO_CNT; i++)
+    if (coro_create (round_robin, (void *) i) == NULL)
+      fail ("coro_create failed");
+  coro_run ();
+  CHECK (order_cnt == CORO_CNT * ROUND_CNT, "all rounds ran");
+  for (i = 0; i < order_cnt; i++)
+    if (order[i] != i % CORO_CNT)
+      fail ("coroutine %d ran out of order", order[i]);
+  CHECK (coro_count () == 0, "all coroutines exited");
+
+  coro_queue_init (&not_empty);
+  coro_queue_init (&not_full);
+  if (coro_create (consumer, NULL) == NULL
+      || coro_create (producer, NULL) == NULL)
+    fail ("coro_create failed");
+  coro_run ();
+  CHECK (sum == ITEM_CNT * (ITEM_CNT + 1) / 2, "producer and consumer");
+  CHECK (coro_count () == 0, "all coroutines exited");
+}
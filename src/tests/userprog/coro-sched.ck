@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(coro-sched) begin
+(coro-sched) create 50 coroutines
+(coro-sched) all rounds ran
+(coro-sched) all coroutines exited
+(coro-sched) producer and consumer
+(coro-sched) all coroutines exited
+(coro-sched) end
+coro-sched: exit(0)
+EOF
+pass;
@@ -0,0 +1,101 @@
+/* Allocates, resizes, and frees blocks of random sizes, from a
+   few bytes to a few tens of kilobytes, checking that no block
+   overwrites another. */
+
+#include <malloc.h>
+#include <random.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of blocks allocated at once, at most. */
+#define BLOCK_CNT 256
+
+/* Number of random operations. */
+#define OP_CNT 20000
+
+static uint8_t *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+/* Returns a random block size, usually small. */
+static size_t
+random_size (void)
+{
+  unsigned r = random_ulong () % 100;
+
+  return (r < 70 ? random_ulong () % 200
+          : r < 95 ? random_ulong () % 3000
+          : random_ulong () % 20000);
+}
+
+/* Fills block I with a pattern that depends on I. */
+static void
+fill (int i)
+{
+  size_t j;
+
+  for (j = 0; j < sizes[i]; j++)
+    blocks[i][j] = i + j;
+}
+
+/* Checks that block I still holds its pattern and is aligned. */
+static void
+verify (int i)
+{
+  size_t j;
+
+  if ((uintptr_t) blocks[i] % 16 != 0)
+    fail ("block %d of %zu bytes is misaligned", i, sizes[i]);
+  for (j = 0; j < sizes[i]; j++)
+    if (blocks[i][j] != (uint8_t) (i + j))
+      fail ("block %d of %zu bytes corrupted at offset %zu",
+            i, sizes[i], j);
+}
+
+void
+test_main (void)
+{
+  int op, i;
+
+  msg ("allocate and free random blocks");
+  for (op = 0; op < OP_CNT; op++)
+    {
+      i = random_ulong () % BLOCK_CNT;
+      if (blocks[i] == NULL)
+        {
+          sizes[i] = random_size ();
+          blocks[i] = malloc (sizes[i]);
+          if (blocks[i] == NULL)
+            fail ("malloc (%zu) failed", sizes[i]);
+          fill (i);
+        }
+      else if (random_ulong () % 4 == 0)
+        {
+          size_t new_size = random_size () + 1;
+
+          blocks[i] = realloc (blocks[i], new_size);
+          if (blocks[i] == NULL)
+            fail ("realloc to %zu bytes failed", new_size);
+          if (new_size < sizes[i])
+            sizes[i] = new_size;
+          verify (i);
+          sizes[i] = new_size;
+          fill (i);
+        }
+      else
+        {
+          verify (i);
+          free (blocks[i]);
+          blocks[i] = NULL;
+        }
+    }
+
+  msg ("free remaining blocks");
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (blocks[i] != NULL)
+      {
+        verify (i);
+        free (blocks[i]);
+      }
+}
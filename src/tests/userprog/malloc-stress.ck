@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-stress) begin
+(malloc-stress) allocate and free random blocks
+(malloc-stress) free remaining blocks
+(malloc-stress) end
+malloc-stress: exit(0)
+EOF
+pass;
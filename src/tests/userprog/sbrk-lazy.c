@@ -0,0 +1,33 @@
+/* Grows the heap by 64 MB, more memory than the machine has,
+   which works only because heap pages are allocated when they
+   are first touched.  Touches some of the pages, then shrinks
+   the heap again. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEAP_SIZE (64 * 1024 * 1024)
+
+void
+test_main (void)
+{
+  char *base = sbrk (0);
+  char *p;
+
+  CHECK (sbrk (HEAP_SIZE) == base, "sbrk (64 MB)");
+  CHECK (sbrk (0) == base + HEAP_SIZE, "break moved up by 64 MB");
+
+  msg ("touch 16 pages");
+  for (p = base; p < base + HEAP_SIZE; p += HEAP_SIZE / 16)
+    {
+      if (*p != 0)
+        fail ("new heap page not zeroed");
+      *p = 'x';
+    }
+
+  CHECK (sbrk (-HEAP_SIZE) == base + HEAP_SIZE, "sbrk (-64 MB)");
+  CHECK (sbrk (-1) == (void *) -1, "shrinking below the heap fails");
+  CHECK (sbrk (INT32_MAX) == (void *) -1, "growing into the stack fails");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sbrk-lazy) begin
+(sbrk-lazy) sbrk (64 MB)
+(sbrk-lazy) break moved up by 64 MB
+(sbrk-lazy) touch 16 pages
+(sbrk-lazy) sbrk (-64 MB)
+(sbrk-lazy) shrinking below the heap fails
+(sbrk-lazy) growing into the stack fails
+(sbrk-lazy) end
+sbrk-lazy: exit(0)
+EOF
+pass;
@@ -0,0 +1,68 @@
+/* Writes a file through a buffered stream with many small
+   writes, then reads it back with small reads, seeks, and mixes
+   reads with writes on a stream open for both. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LINE_CNT 500
+#define BLOCK_SIZE 6000
+
+static char block[BLOCK_SIZE];
+static char buf[BLOCK_SIZE];
+
+void
+test_main (void)
+{
+  FILE *f;
+  long block_ofs;
+  char line[32], expect[32];
+  int i;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    block[i] = 'a' + i % 26;
+
+  CHECK (fopen ("missing", "r") == NULL, "fopen \"missing\" fails");
+
+  CHECK ((f = fopen ("stream", "w")) != NULL, "fopen \"stream\" for writing");
+  for (i = 0; i < LINE_CNT; i++)
+    if (fprintf (f, "line %d\n", i) <= 0)
+      fail ("fprintf failed at line %d", i);
+  block_ofs = ftell (f);
+  if (fwrite (block, 1, BLOCK_SIZE, f) != BLOCK_SIZE)
+    fail ("fwrite failed");
+  CHECK (fclose (f) == 0, "fclose \"stream\"");
+
+  CHECK ((f = fopen ("stream", "r")) != NULL, "fopen \"stream\" for reading");
+  msg ("read lines");
+  for (i = 0; i < LINE_CNT; i++)
+    {
+      snprintf (expect, sizeof expect, "line %d\n", i);
+      if (fgets (line, sizeof line, f) == NULL || strcmp (line, expect))
+        fail ("bad line %d", i);
+    }
+  CHECK (ftell (f) == block_ofs, "ftell after lines");
+  CHECK (fread (buf, 1, BLOCK_SIZE, f) == BLOCK_SIZE
+         && !memcmp (buf, block, BLOCK_SIZE), "read block");
+  CHECK (fgetc (f) == EOF && feof (f), "end of file");
+
+  CHECK (fseek (f, -BLOCK_SIZE / 2, SEEK_END) == 0
+         && fgetc (f) == block[BLOCK_SIZE / 2], "seek from end");
+  CHECK (fseek (f, 5, SEEK_SET) == 0 && fgets (line, sizeof line, f) != NULL
+         && !strcmp (line, "0\n"), "seek from start");
+  CHECK (fclose (f) == 0, "fclose \"stream\"");
+
+  CHECK ((f = fopen ("stream", "r+")) != NULL, "fopen \"stream\" for update");
+  fgets (line, sizeof line, f);
+  fputs ("LINE", f);
+  CHECK (fgets (line, sizeof line, f) != NULL && !strcmp (line, " 1\n"),
+         "read after write");
+  CHECK (fseek (f, 0, SEEK_SET) == 0 && fgets (line, sizeof line, f) != NULL
+         && !strcmp (line, "line 0\n")
+         && fgets (line, sizeof line, f) != NULL
+         && !strcmp (line, "LINE 1\n"), "write landed in place");
+  CHECK (fclose (f) == 0, "fclose \"stream\"");
+}
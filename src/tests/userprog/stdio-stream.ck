@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stdio-stream) begin
+(stdio-stream) fopen "missing" fails
+(stdio-stream) fopen "stream" for writing
+(stdio-stream) fclose "stream"
+(stdio-stream) fopen "stream" for reading
+(stdio-stream) read lines
+(stdio-stream) ftell after lines
+(stdio-stream) read block
+(stdio-stream) end of file
+(stdio-stream) seek from end
+(stdio-stream) seek from start
+(stdio-stream) fclose "stream"
+(stdio-stream) fopen "stream" for update
+(stdio-stream) read after write
+(stdio-stream) write landed in place
+(stdio-stream) fclose "stream"
+(stdio-stream) end
+stdio-stream: exit(0)
+EOF
+pass;
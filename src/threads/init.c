@@ -29,11 +29,16 @@
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
+#include "tests/bench/bench.h"
 #include "tests/threads/tests.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "devices/stripe.h"
+#include "devices/pci.h"
+#include "devices/virtio-blk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -42,8 +47,10 @@
 uint32_t *init_page_dir;
 
 #ifdef FILESYS
-/* -f: Format the file system? */
+/* -f: Format the file system?
+   -fsblock: Block size in bytes to format it with. */
 static bool format_filesys;
+static size_t format_block_size = BLOCK_SECTOR_SIZE;
 
 /* -filesys, -scratch, -swap: Names of block devices to use,
    overriding the defaults. */
@@ -52,6 +59,17 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -blktrace: Number of block requests to trace. */
+static size_t blktrace_cnt;
+
+/* -ramdisk: Size of RAM disk in kB, 0 for none.
+   -ramdisk-load: Copy scratch device into RAM disk? */
+static size_t ramdisk_kb;
+static bool ramdisk_load;
+
+/* -stripe: Member devices and chunk size of striped device. */
+static char *stripe_spec;
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
@@ -122,9 +140,13 @@ main (void)
 
 #ifdef FILESYS
   /* Initialize file system. */
+  if (blktrace_cnt > 0)
+    block_trace_init (blktrace_cnt);
+  pci_init ();
   ide_init ();
+  virtio_blk_init ();
   locate_block_devices ();
-  filesys_init (format_filesys);
+  filesys_init (format_filesys, format_block_size);
 #endif
 
   printf ("Boot complete.\n");
@@ -243,15 +265,36 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-fsblock"))
+        format_block_size = atoi (value);
       else if (!strcmp (name, "-filesys"))
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-blktrace"))
+        {
+          int cnt = value != NULL ? atoi (value) : 0;
+          if (cnt <= 0)
+            PANIC ("-blktrace count must be positive, not `%s'",
+                   value != NULL ? value : "");
+          blktrace_cnt = cnt;
+        }
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_kb = atoi (value);
+      else if (!strcmp (name, "-ramdisk-load"))
+        ramdisk_load = true;
+      else if (!strcmp (name, "-stripe"))
+        stripe_spec = value;
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
 #endif
 #endif
+      else if (!strcmp (name, "-baud")) 
+        {
+          if (!serial_set_bps (atoi (value)))
+            PANIC ("unsupported serial data rate `%s'", value);
+        }
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
@@ -287,7 +330,8 @@ run_task (char **argv)
 #ifdef USERPROG
   process_wait (process_execute (task));
 #else
-  run_test (task);
+  if (!run_bench (task))
+    run_test (task);
 #endif
   printf ("Execution of '%s' complete.\n", task);
 }
@@ -371,12 +415,19 @@ usage (void)
           "  -r                 Reboot after actions.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
+          "  -fsblock=BYTES     With -f, use BYTES-byte blocks (512...4096).\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -blktrace=COUNT    Print last COUNT block requests at exit.\n"
+          "  -ramdisk=SIZE      Create SIZE kB RAM disk ram0.\n"
+          "  -ramdisk-load      Copy scratch device into ram0 at startup.\n"
+          "  -stripe=BDEV,BDEV[,...][:KB]  Stripe BDEVs into md0 with KB\n"
+          "                     kB chunks, and use it for file system.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
+          "  -baud=BPS          Set serial port to BPS bits/s (default 115200).\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
@@ -391,8 +442,21 @@ usage (void)
 static void
 locate_block_devices (void)
 {
-  locate_block_device (BLOCK_FILESYS, filesys_bdev_name);
+  /* Locate scratch first, since the RAM disk may be loaded from
+     it, and then the RAM disk can be used in the other roles. */
   locate_block_device (BLOCK_SCRATCH, scratch_bdev_name);
+  if (ramdisk_kb > 0)
+    ramdisk_init (DIV_ROUND_UP (ramdisk_kb * 1024, PGSIZE),
+                  ramdisk_load ? block_get_role (BLOCK_SCRATCH) : NULL);
+  else if (ramdisk_load)
+    PANIC ("-ramdisk-load requires -ramdisk");
+  if (stripe_spec != NULL) 
+    {
+      stripe_init (stripe_spec);
+      if (filesys_bdev_name == NULL)
+        filesys_bdev_name = "md0";
+    }
+  locate_block_device (BLOCK_FILESYS, filesys_bdev_name);
 #ifdef VM
   locate_block_device (BLOCK_SWAP, swap_bdev_name);
 #endif
@@ -401,7 +465,8 @@ locate_block_devices (void)
 /* Figures out what block device to use for the given ROLE: the
    block device with the given NAME, if NAME is non-null,
    otherwise the first block device in probe order of type
-   ROLE. */
+   ROLE.  Members of the striped device md0 and their partitions
+   belong to md0 and are never used in another role. */
 static void
 locate_block_device (enum block_type role, const char *name)
 {
@@ -412,11 +477,13 @@ locate_block_device (enum block_type role, const char *name)
       block = block_get_by_name (name);
       if (block == NULL)
         PANIC ("No such block device \"%s\"", name);
+      if (stripe_has_member (block))
+        PANIC ("%s is on a member of md0", name);
     }
   else
     {
       for (block = block_first (); block != NULL; block = block_next (block))
-        if (block_type (block) == role)
+        if (block_type (block) == role && !stripe_has_member (block))
           break;
     }
 
@@ -32,15 +32,47 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each descriptor also keeps statistics that malloc_print_stats()
+   reports: how many blocks were handed out and given back, how
+   many are live right now and at most, how many arenas back
+   them, and how many bytes were lost to rounding requests up to
+   the block size.
+
+   In debug builds (without NDEBUG), every block is also tagged
+   with the call site that allocated it, so that blocks that are
+   still live at shutdown can be traced back to their owner.
+   Small blocks keep a one-byte site index in an array between
+   the arena header and the first block; big blocks keep it in
+   the arena header itself. */
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    size_t block_ofs;           /* Offset of first block in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics, protected by LOCK. */
+    unsigned long long alloc_cnt;       /* Blocks handed out. */
+    unsigned long long free_cnt;        /* Blocks given back. */
+    unsigned long long req_bytes;       /* Bytes requested for them. */
+    size_t live_cnt, live_peak;         /* Blocks in use, high water. */
+    size_t arena_cnt, arena_peak;       /* Arenas held, high water. */
+  };
+
+/* Statistics for big blocks, which have no descriptor. */
+struct big_stats
+  {
+    struct lock lock;                   /* Protects the members below. */
+    unsigned long long alloc_cnt;       /* Big blocks handed out. */
+    unsigned long long free_cnt;        /* Big blocks given back. */
+    unsigned long long req_bytes;       /* Bytes requested for them. */
+    unsigned long long page_total;      /* Pages handed out for them. */
+    size_t page_cnt, page_peak;         /* Pages in use, high water. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -52,6 +84,9 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+#ifndef NDEBUG
+    uint8_t site;               /* Allocating call site of big block. */
+#endif
   };
 
 /* Free block. */
@@ -64,6 +99,33 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Big block statistics. */
+static struct big_stats big;
+
+#ifndef NDEBUG
+/* A call site that allocates memory.
+   Site 0 collects everything that does not fit in the table. */
+struct site
+  {
+    const void *caller;         /* Return address into the caller. */
+    unsigned long long alloc_cnt;       /* Blocks allocated here. */
+    size_t live_cnt;            /* Blocks from here still in use. */
+    size_t live_bytes;          /* Bytes from here still in use. */
+  };
+
+/* Maximum number of distinct call sites tracked.
+   Must fit in the uint8_t used to tag blocks. */
+#define SITE_CNT 64
+
+static struct site sites[SITE_CNT];
+static struct lock site_lock;
+
+static uint8_t site_get (const void *caller, size_t bytes);
+static void site_put (uint8_t site, size_t bytes);
+static uint8_t *arena_site (struct arena *, struct block *);
+#endif
+
+static void *malloc_at (size_t, const void *caller);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -78,16 +140,42 @@ malloc_init (void)
       struct desc *d = &descs[desc_cnt++];
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
+#ifndef NDEBUG
+      /* Leave room for a one-byte site tag per block, then pad
+         so that the first block stays aligned like the others. */
+      d->blocks_per_arena = ((PGSIZE - sizeof (struct arena))
+                             / (block_size + 1));
+      while (ROUND_UP (sizeof (struct arena) + d->blocks_per_arena, 16)
+             + d->blocks_per_arena * block_size > PGSIZE)
+        d->blocks_per_arena--;
+      d->block_ofs = ROUND_UP (sizeof (struct arena) + d->blocks_per_arena,
+                               16);
+#else
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+      d->block_ofs = sizeof (struct arena);
+#endif
       list_init (&d->free_list);
       lock_init (&d->lock);
     }
+  lock_init (&big.lock);
+#ifndef NDEBUG
+  lock_init (&site_lock);
+#endif
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return malloc_at (size, __builtin_return_address (0));
+}
+
+/* Obtains and returns a new block of at least SIZE bytes on
+   behalf of the call site that returns to CALLER.
+   Returns a null pointer if memory is not available. */
+static void *
+malloc_at (size_t size, const void *caller UNUSED) 
 {
   struct desc *d;
   struct block *b;
@@ -116,6 +204,18 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+#ifndef NDEBUG
+      a->site = site_get (caller, page_cnt * PGSIZE);
+#endif
+
+      lock_acquire (&big.lock);
+      big.alloc_cnt++;
+      big.req_bytes += size;
+      big.page_total += page_cnt;
+      big.page_cnt += page_cnt;
+      if (big.page_cnt > big.page_peak)
+        big.page_peak = big.page_cnt;
+      lock_release (&big.lock);
       return a + 1;
     }
 
@@ -143,12 +243,21 @@ malloc (size_t size)
           struct block *b = arena_to_block (a, i);
           list_push_back (&d->free_list, &b->free_elem);
         }
+      if (++d->arena_cnt > d->arena_peak)
+        d->arena_peak = d->arena_cnt;
     }
 
   /* Get a block from free list and return it. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  d->alloc_cnt++;
+  d->req_bytes += size;
+  if (++d->live_cnt > d->live_peak)
+    d->live_peak = d->live_cnt;
+#ifndef NDEBUG
+  *arena_site (a, b) = site_get (caller, d->block_size);
+#endif
   lock_release (&d->lock);
   return b;
 }
@@ -167,7 +276,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = malloc_at (size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -201,7 +310,7 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = malloc_at (new_size, __builtin_return_address (0));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -235,6 +344,12 @@ free (void *p)
   
           lock_acquire (&d->lock);
 
+#ifndef NDEBUG
+          site_put (*arena_site (a, b), d->block_size);
+#endif
+          d->free_cnt++;
+          d->live_cnt--;
+
           /* Add block to free list. */
           list_push_front (&d->free_list, &b->free_elem);
 
@@ -250,6 +365,7 @@ free (void *p)
                   list_remove (&b->free_elem);
                 }
               palloc_free_page (a);
+              d->arena_cnt--;
             }
 
           lock_release (&d->lock);
@@ -257,7 +373,17 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
+          size_t page_cnt = a->free_cnt;
+
+#ifndef NDEBUG
+          site_put (a->site, page_cnt * PGSIZE);
+#endif
+          lock_acquire (&big.lock);
+          big.free_cnt++;
+          big.page_cnt -= page_cnt;
+          lock_release (&big.lock);
+
+          palloc_free_multiple (a, page_cnt);
           return;
         }
     }
@@ -275,7 +401,8 @@ block_to_arena (struct block *b)
 
   /* Check that the block is properly aligned for the arena. */
   ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
+          || (pg_ofs (b) >= a->desc->block_ofs
+              && (pg_ofs (b) - a->desc->block_ofs) % a->desc->block_size == 0));
   ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
 
   return a;
@@ -289,6 +416,122 @@ arena_to_block (struct arena *a, size_t idx)
   ASSERT (a->magic == ARENA_MAGIC);
   ASSERT (idx < a->desc->blocks_per_arena);
   return (struct block *) ((uint8_t *) a
-                           + sizeof *a
+                           + a->desc->block_ofs
                            + idx * a->desc->block_size);
 }
+
+/* Prints statistics for each block size that has seen use, for
+   big blocks, and in debug builds for the call sites that own
+   the most memory that is still allocated.
+   Like the other statistics printers, takes no locks, so that
+   it can run during shutdown after a kernel panic. */
+void
+malloc_print_stats (void) 
+{
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->alloc_cnt > 0)
+      printf ("Malloc: %zu-byte blocks: %llu allocs, %llu frees, "
+              "%zu live (peak %zu), %zu arenas (peak %zu), "
+              "%llu bytes rounding waste\n",
+              d->block_size, d->alloc_cnt, d->free_cnt,
+              d->live_cnt, d->live_peak, d->arena_cnt, d->arena_peak,
+              d->alloc_cnt * d->block_size - d->req_bytes);
+
+  if (big.alloc_cnt > 0)
+    printf ("Malloc: big blocks: %llu allocs, %llu frees, "
+            "%zu pages live (peak %zu), %llu bytes rounding waste\n",
+            big.alloc_cnt, big.free_cnt, big.page_cnt, big.page_peak,
+            big.page_total * PGSIZE - big.req_bytes);
+
+#ifndef NDEBUG
+  {
+    /* Print the sites holding the most live bytes, largest
+       first.  Use the backtrace utility to turn the addresses
+       into function names. */
+    enum { TOP_SITES = 8 };
+    bool printed[SITE_CNT];
+    int i, j;
+
+    memset (printed, 0, sizeof printed);
+    for (i = 0; i < TOP_SITES; i++) 
+      {
+        struct site *top = NULL;
+        for (j = 0; j < SITE_CNT; j++)
+          if (!printed[j] && sites[j].live_cnt > 0
+              && (top == NULL || sites[j].live_bytes > top->live_bytes))
+            top = &sites[j];
+        if (top == NULL)
+          break;
+        printed[top - sites] = true;
+        printf ("Malloc: %zu blocks (%zu bytes) live from %p, "
+                "%llu allocated there\n", top->live_cnt, top->live_bytes,
+                top->caller, top->alloc_cnt);
+      }
+  }
+#endif
+}
+
+#ifndef NDEBUG
+/* Records an allocation of BYTES bytes from the call site that
+   returns to CALLER, and returns the tag for that site. */
+static uint8_t
+site_get (const void *caller, size_t bytes) 
+{
+  size_t start = ((uintptr_t) caller >> 2) % (SITE_CNT - 1) + 1;
+  size_t i = start;
+  struct site *s;
+
+  lock_acquire (&site_lock);
+  for (;;)
+    {
+      s = &sites[i];
+      if (s->caller == caller)
+        break;
+      else if (s->caller == NULL)
+        {
+          s->caller = caller;
+          break;
+        }
+
+      i = i % (SITE_CNT - 1) + 1;
+      if (i == start)
+        {
+          /* Table full: account to the overflow site. */
+          s = &sites[0];
+          break;
+        }
+    }
+  s->alloc_cnt++;
+  s->live_cnt++;
+  s->live_bytes += bytes;
+  lock_release (&site_lock);
+
+  return s - sites;
+}
+
+/* Records that a block of BYTES bytes tagged with SITE has been
+   freed. */
+static void
+site_put (uint8_t site, size_t bytes) 
+{
+  ASSERT (site < SITE_CNT);
+
+  lock_acquire (&site_lock);
+  ASSERT (sites[site].live_cnt > 0);
+  sites[site].live_cnt--;
+  sites[site].live_bytes -= bytes;
+  lock_release (&site_lock);
+}
+
+/* Returns the site tag of block B within small-block arena A. */
+static uint8_t *
+arena_site (struct arena *a, struct block *b) 
+{
+  size_t idx = (pg_ofs (b) - a->desc->block_ofs) / a->desc->block_size;
+
+  ASSERT (idx < a->desc->blocks_per_arena);
+  return (uint8_t *) (a + 1) + idx;
+}
+#endif
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,7 +24,12 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool counts the pages in use, their high water mark, and
+   the allocations that failed.  palloc_print_stats() reports
+   these along with the pool's free runs, whose count and
+   largest size show how fragmented the pool has become. */
 
 /* A memory pool. */
 struct pool
@@ -31,6 +37,12 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+
+    /* Statistics, protected by disabling interrupts. */
+    size_t used_cnt;                    /* Pages in use. */
+    size_t used_peak;                   /* High water mark of used_cnt. */
+    unsigned long long fail_cnt;        /* Allocations that failed. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +51,7 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void print_pool_stats (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,6 +84,7 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
 
@@ -81,6 +95,17 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
   lock_release (&pool->lock);
 
+  old_level = intr_disable ();
+  if (page_idx != BITMAP_ERROR)
+    {
+      pool->used_cnt += page_cnt;
+      if (pool->used_cnt > pool->used_peak)
+        pool->used_peak = pool->used_cnt;
+    }
+  else
+    pool->fail_cnt++;
+  intr_set_level (old_level);
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
@@ -118,6 +143,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -139,6 +165,13 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+
+  /* We may be called from thread_schedule_tail() with
+     interrupts off, where taking the pool lock is not allowed,
+     so the counters are protected by disabling interrupts. */
+  old_level = intr_disable ();
+  pool->used_cnt -= page_cnt;
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -167,6 +200,7 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   lock_init (&p->lock);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  p->name = name;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +214,47 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Prints page usage and fragmentation statistics for each
+   pool. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
+/* Prints statistics for POOL, including the number of runs of
+   free pages and the size of the largest one, which bounds the
+   biggest palloc_get_multiple() request that can succeed.
+   Like the other statistics printers, takes no locks, so that
+   it can run during shutdown after a kernel panic. */
+static void
+print_pool_stats (struct pool *pool) 
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+  size_t run_cnt = 0, largest_run = 0;
+  size_t start = 0;
+
+  while (start < page_cnt) 
+    {
+      size_t run_start, run_end;
+
+      run_start = bitmap_scan (pool->used_map, start, 1, false);
+      if (run_start == BITMAP_ERROR)
+        break;
+      run_end = bitmap_scan (pool->used_map, run_start, 1, true);
+      if (run_end == BITMAP_ERROR)
+        run_end = page_cnt;
+
+      run_cnt++;
+      if (run_end - run_start > largest_run)
+        largest_run = run_end - run_start;
+      start = run_end;
+    }
+
+  printf ("Palloc: %s: %zu of %zu pages used (peak %zu), "
+          "%zu free runs (largest %zu pages), %llu failed allocations\n",
+          pool->name, pool->used_cnt, page_cnt, pool->used_peak, run_cnt,
+          largest_run, pool->fail_cnt);
+}
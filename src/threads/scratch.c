@@ -0,0 +1,158 @@
+#include "threads/scratch.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Per-thread scratch arenas.
+
+   Kernel threads run on a 4 kB stack, so code that needs a
+   sector-sized or path-sized temporary cannot simply declare it
+   as a local variable.  malloc() works, but costs a lock and a
+   free-list operation on every call, which adds up in hot paths
+   such as file writes and path lookups.
+
+   Instead, each thread owns a scratch arena: a stack of pages
+   obtained from the page allocator, carved up by bumping an
+   offset.  Allocation needs no lock, because only the owning
+   thread ever touches its arena.  Nothing is freed individually.
+   Instead, the caller records a position with scratch_mark()
+   before allocating and hands it back to scratch_release() when
+   its temporaries are dead, which frees them all at once:
+
+        size_t mark = scratch_mark ();
+        char *buf = scratch_alloc (len + 1);
+        ...
+        scratch_release (mark);
+
+   Marks must be released in LIFO order, like stack frames.  A
+   function that takes a mark must release it before returning.
+
+   A mark encodes the depth of the current page in the arena
+   times PGSIZE, plus the offset into that page, so it is a
+   plain integer that can only grow as more is allocated.
+
+   The arena's first page is kept across releases, so the common
+   case of a single small allocation never reaches the page
+   allocator after the first time.  All pages are returned when
+   the thread exits. */
+
+/* Header at the start of each scratch page. */
+struct scratch_page
+  {
+    struct scratch_page *prev;  /* Next page down in the arena. */
+    size_t depth;               /* Number of pages below this one. */
+  };
+
+/* Allocations are aligned to this many bytes. */
+#define SCRATCH_ALIGN 8
+
+/* Offset of the first usable byte in a scratch page. */
+#define SCRATCH_START ROUND_UP (sizeof (struct scratch_page), SCRATCH_ALIGN)
+
+/* Largest possible single allocation.  Leaves a little slack so
+   that the offset within a page is always less than PGSIZE and
+   a mark can be split back into a depth and an offset. */
+#define SCRATCH_MAX (PGSIZE - SCRATCH_START - SCRATCH_ALIGN)
+
+/* Returns a block of at least SIZE bytes from the running
+   thread's scratch arena, or a null pointer if SIZE is bigger
+   than a page minus a small header or if memory is not
+   available.  The block remains valid until a scratch_release()
+   of a mark taken before the allocation. */
+void *
+scratch_alloc (size_t size) 
+{
+  struct thread *t = thread_current ();
+  void *p;
+
+  ASSERT (!intr_context ());
+
+  if (size > SCRATCH_MAX)
+    return NULL;
+  size = ROUND_UP (size, SCRATCH_ALIGN);
+
+  if (t->scratch == NULL || t->scratch_ofs + size >= PGSIZE) 
+    {
+      /* Push a new page on top of the arena. */
+      struct scratch_page *page = palloc_get_page (0);
+      if (page == NULL)
+        return NULL;
+      page->prev = t->scratch;
+      page->depth = t->scratch != NULL ? t->scratch->depth + 1 : 0;
+      t->scratch = page;
+      t->scratch_ofs = SCRATCH_START;
+    }
+
+  p = (uint8_t *) t->scratch + t->scratch_ofs;
+  t->scratch_ofs += size;
+  return p;
+}
+
+/* Like scratch_alloc(), but zeroes the returned block. */
+void *
+scratch_zalloc (size_t size) 
+{
+  void *p = scratch_alloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+  return p;
+}
+
+/* Returns the current position in the running thread's scratch
+   arena, for later use with scratch_release(). */
+size_t
+scratch_mark (void) 
+{
+  struct thread *t = thread_current ();
+
+  if (t->scratch == NULL)
+    return SCRATCH_START;
+  return t->scratch->depth * PGSIZE + t->scratch_ofs;
+}
+
+/* Frees every block allocated from the running thread's scratch
+   arena since MARK was returned by scratch_mark(). */
+void
+scratch_release (size_t mark) 
+{
+  struct thread *t = thread_current ();
+  size_t depth = mark / PGSIZE;
+
+  if (t->scratch == NULL)
+    {
+      ASSERT (mark == SCRATCH_START);
+      return;
+    }
+
+  /* Pop pages pushed since the mark, but keep the bottom one. */
+  while (t->scratch->depth > depth) 
+    {
+      struct scratch_page *page = t->scratch;
+      t->scratch = page->prev;
+      palloc_free_page (page);
+    }
+  ASSERT (t->scratch->depth == depth);
+
+  ASSERT (mark % PGSIZE <= t->scratch_ofs);
+  t->scratch_ofs = mark % PGSIZE;
+}
+
+/* Frees all the pages in the running thread's scratch arena.
+   Called when the thread exits. */
+void
+scratch_destroy (void) 
+{
+  struct thread *t = thread_current ();
+
+  while (t->scratch != NULL) 
+    {
+      struct scratch_page *page = t->scratch;
+      t->scratch = page->prev;
+      palloc_free_page (page);
+    }
+}
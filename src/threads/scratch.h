@@ -0,0 +1,14 @@
+#ifndef THREADS_SCRATCH_H
+#define THREADS_SCRATCH_H
+
+#include <stddef.h>
+
+/* Per-thread scratch memory for short-lived kernel temporaries.
+   See scratch.c for details. */
+void *scratch_alloc (size_t) __attribute__ ((malloc));
+void *scratch_zalloc (size_t) __attribute__ ((malloc));
+size_t scratch_mark (void);
+void scratch_release (size_t mark);
+void scratch_destroy (void);
+
+#endif /* threads/scratch.h */
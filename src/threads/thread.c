@@ -10,6 +10,7 @@
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/scratch.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -490,6 +491,7 @@ thread_exit (void)
   process_exit ();
   free (cur->open_files);
 #endif
+  scratch_destroy ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
@@ -123,6 +123,9 @@ struct thread
     struct semaphore exited;            /* Semaphore for signaling process exit. */
 
     struct file *exec_file;             /* Process's opened executable file. */
+
+    uint8_t *heap_start;                /* Start of heap, above the executable. */
+    uint8_t *heap_break;                /* End of heap, moved by sbrk(). */
 #endif
 #ifdef FILESYS
   block_sector_t cwd;           /* Current working directory */
@@ -143,6 +146,13 @@ struct thread
     int32_t recent_cpu;                 /* Amount of CPU time received "recently". */
     int nice;                           /* Nice value. */
 
+    /* Owned by devices/block.c. */
+    enum block_io_class io_class;       /* I/O class, or BLOCK_IO_AUTO. */
+
+    /* Owned by threads/scratch.c. */
+    struct scratch_page *scratch;       /* Top page of scratch arena. */
+    size_t scratch_ofs;                 /* First free byte in top page. */
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
@@ -1,4 +1,5 @@
 #include "userprog/exception.h"
+#include "userprog/heap.h"
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -139,6 +140,12 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  /* Heap pages are allocated on first touch, whether by the
+     process itself or by the kernel on its behalf. */
+  if (not_present && is_user_vaddr (fault_addr)
+      && process_heap_fault (fault_addr))
+    return;
+
   /* If user address is accesed by the kernel, don't kill the thread
      and instead help with `int get_user(const uint8_t *uaddr)` in userprog/syscall.c */
   if (!user && is_user_vaddr (fault_addr))
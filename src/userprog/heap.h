@@ -0,0 +1,13 @@
+#ifndef USERPROG_HEAP_H
+#define USERPROG_HEAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* User process heap, implemented in process.c.  Kept out of
+   process.h so that exception.c can use it without pulling in
+   that header's dependencies. */
+void *process_sbrk (intptr_t increment);
+bool process_heap_fault (const void *fault_addr);
+
+#endif /* userprog/heap.h */
@@ -43,6 +43,75 @@ process_close_fd (int fd)
     cur->next_fd = fd;
 }
 
+/* Address space below PHYS_BASE that the heap may not grow into,
+   left for the stack. */
+#define STACK_RESERVE (8 * 1024 * 1024)
+
+/* Moves the current process's break, the end of its heap, by
+   INCREMENT bytes, which may be negative.  Returns the old
+   break, or (void *) -1 if the heap would shrink below its
+   start or grow into the stack.
+
+   Growing the heap only reserves address space.  Each page is
+   allocated and zeroed by process_heap_fault() when it is first
+   touched, so a process can reserve a large heap cheaply.
+   Shrinking the heap frees the pages above the new break. */
+void *
+process_sbrk (intptr_t increment)
+{
+  struct thread *t = thread_current ();
+  uint8_t *old_break = t->heap_break;
+  uint8_t *limit = (uint8_t *) PHYS_BASE - STACK_RESERVE;
+
+  if (increment >= 0
+      ? (uintptr_t) (limit - old_break) < (uintptr_t) increment
+      : (uintptr_t) (old_break - t->heap_start) < -(uintptr_t) increment)
+    return (void *) -1;
+
+  t->heap_break = old_break + increment;
+  if (increment < 0)
+    {
+      uint8_t *upage;
+
+      for (upage = pg_round_up (t->heap_break); upage < old_break;
+           upage += PGSIZE)
+        {
+          void *kpage = pagedir_get_page (t->pagedir, upage);
+          if (kpage != NULL)
+            {
+              pagedir_clear_page (t->pagedir, upage);
+              palloc_free_page (kpage);
+            }
+        }
+    }
+  return old_break;
+}
+
+/* Handles a fault on not-present user address FAULT_ADDR in the
+   current process by mapping a zeroed page there, if the address
+   is in the heap.  Returns true if successful, false if the
+   address is not in the heap or no memory is available. */
+bool
+process_heap_fault (const void *fault_addr)
+{
+  struct thread *t = thread_current ();
+  const uint8_t *addr = fault_addr;
+  uint8_t *kpage;
+
+  if (t->pagedir == NULL || addr < t->heap_start || addr >= t->heap_break)
+    return false;
+
+  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL)
+    return false;
+  if (!pagedir_set_page (t->pagedir, pg_round_down (fault_addr), kpage, true))
+    {
+      palloc_free_page (kpage);
+      return false;
+    }
+  return true;
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -476,6 +545,12 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+
+              /* The heap starts above the highest segment. */
+              if ((uint8_t *) mem_page + read_bytes + zero_bytes
+                  > t->heap_start)
+                t->heap_start = ((uint8_t *) mem_page
+                                 + read_bytes + zero_bytes);
             }
           else
             goto done;
@@ -483,6 +558,8 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
+  t->heap_break = t->heap_start;
+
   /* Set up stack. */
   if (!setup_stack (esp))
     goto done;
@@ -147,8 +147,10 @@ sys_read (int fd, void *buffer_, unsigned length)
 
   if (fd == STDIN_FILENO)
     {
-      while (length--)
-        *(buf++) = input_getc ();
+      unsigned i;
+
+      for (i = 0; i < length; i++)
+        buf[i] = input_getc ();
       return length;
     }
 
@@ -236,6 +238,44 @@ sys_close (int fd)
     }
 }
 
+static void *
+sys_sbrk (intptr_t increment)
+{
+  return process_sbrk (increment);
+}
+
+static bool
+sys_mkdir (const char *dir)
+{
+  bool ret;
+
+  check_user_str_and_kill (dir);
+
+  lock_acquire (&fslock);
+  ret = filesys_create_dir (dir);
+  lock_release (&fslock);
+  return ret;
+}
+
+static bool
+sys_fsstat (struct fsstat *stats)
+{
+  struct cache_stats cs;
+  struct block_stats bs;
+
+  check_user_buf_and_kill ((uint8_t *) stats, sizeof *stats);
+
+  cache_get_stats (&cs);
+  block_get_stats (fs_device, &bs);
+  stats->cache_hits = cs.hits;
+  stats->cache_misses = cs.misses;
+  stats->cache_evictions = cs.evictions;
+  stats->cache_read_aheads = cs.read_aheads;
+  stats->dev_reads = bs.read_cnt;
+  stats->dev_writes = bs.write_cnt;
+  return true;
+}
+
 static void
 syscall_handler (struct intr_frame *f) 
 {
@@ -297,6 +337,25 @@ syscall_handler (struct intr_frame *f)
       sys_close (
         (int) get_user_word (f->esp + 4)); /* fd */
       break;
+    case SYS_SBRK:
+      f->eax = (uintptr_t) sys_sbrk (
+        (intptr_t) get_user_word (f->esp + 4)); /* increment */
+      break;
+    case SYS_MKDIR:
+      f->eax = sys_mkdir (
+        (char *) get_user_word (f->esp + 4)); /* dir */
+      break;
+    case SYS_NSECS:
+      {
+        uint64_t ns = timer_nsecs ();
+        f->eax = ns;
+        f->edx = ns >> 32;
+      }
+      break;
+    case SYS_FSSTAT:
+      f->eax = sys_fsstat (
+        (struct fsstat *) get_user_word (f->esp + 4)); /* stats */
+      break;
     default:
       printf ("system call!\n");
       break;
@@ -13,6 +13,8 @@
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "filesys/filesys.h"
+#include "filesys/cache.h"
+#include "devices/timer.h"
 /* Very coarse lock to synchronize any access to filesystem code. */
 struct lock fslock;
 